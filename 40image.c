@@ -13,12 +13,23 @@
 **************************************************************************/
 
 #include <string.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include "assert.h"
 #include "compress40.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "check40.h"
+#include "stream40.h"
+#include "layout.h"
+#include "order.h"
+#include "tempmap.h"
 
 static void (*compress_or_decompress)(FILE *input) = compress40;
+static bool check = false;
+static bool stream = false;
+static bool column_order = false;
 
 int main(int argc, char *argv[])
 {
@@ -29,13 +40,77 @@ int main(int argc, char *argv[])
                         compress_or_decompress = compress40;
                 } else if (strcmp(argv[i], "-d") == 0) {
                         compress_or_decompress = decompress40;
+                } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                        char *end;
+                        long nthreads = strtol(argv[++i], &end, 10);
+                        if (*end != '\0' || nthreads < 1) {
+                                fprintf(stderr, "%s: bad thread count '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        Parallel_set_threads((unsigned) nthreads);
+                } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+                        Dispatch_tier tier;
+                        if (!Dispatch_parse(argv[++i], &tier)) {
+                                fprintf(stderr, "%s: unknown tier '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        if (tier > Dispatch_best()) {
+                                fprintf(stderr, "%s: this CPU does not "
+                                        "support tier '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        Dispatch_force(tier);
+                } else if (strcmp(argv[i], "-check") == 0) {
+                        check = true;
+                } else if (strcmp(argv[i], "-stream") == 0) {
+                        stream = true;
+                } else if (strcmp(argv[i], "-outofcore") == 0) {
+                        Tempmap_set_files(true);
+                } else if (strcmp(argv[i], "-fixed") == 0) {
+                        Dispatch_set_fixed_point(true);
+                } else if (strcmp(argv[i], "-order") == 0 &&
+                           i + 1 < argc) {
+                        i++;
+                        if (strcmp(argv[i], "row") == 0) {
+                                Order_set_row_major(true);
+                                column_order = false;
+                        } else if (strcmp(argv[i], "column") == 0) {
+                                Order_set_row_major(false);
+                                column_order = true;
+                        } else {
+                                fprintf(stderr, "%s: unknown order '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                } else if (strcmp(argv[i], "-layout") == 0 &&
+                           i + 1 < argc) {
+                        Layout_T layout;
+                        if (!Layout_parse(argv[++i], &layout)) {
+                                fprintf(stderr, "%s: unknown layout '%s'\n",
+                                        argv[0], argv[i]);
+                                exit(1);
+                        }
+                        Layout_set(layout);
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
                 } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
+                        fprintf(stderr, "Usage: %s -d [-j threads] [-t tier] "
+                                "[-check | -stream] [-fixed] "
+                                "[-outofcore] [filename]\n"
+                                "       %s -c [-j threads] [-t tier] "
+                                "[-check | -stream] [-fixed] "
+                                "[-layout layout] [-order order] "
+                                "[-outofcore] [filename]\n"
+                                "tiers: scalar, sse2, avx2, avx512\n"
+                                "layouts: 6-6-6-6-4-4 (default), "
+                                "9-5-5-5-4-4\n"
+                                "orders: column (default), row "
+                                "(always with -stream)\n",
                                 argv[0], argv[0]);
                         exit(1);
                 } else {
@@ -43,6 +118,27 @@ int main(int argc, char *argv[])
                 }
         }
         assert(argc - i <= 1);    /* at most one file on command line */
+        if (check && stream) {
+                fprintf(stderr, "%s: -check and -stream cannot be used "
+                        "together\n", argv[0]);
+                exit(1);
+        }
+        if (stream && column_order &&
+            compress_or_decompress == compress40) {
+                fprintf(stderr, "%s: -stream compresses in row order "
+                        "only\n", argv[0]);
+                exit(1);
+        }
+        if (stream) {
+                compress_or_decompress =
+                        compress_or_decompress == compress40
+                        ? stream_compress40 : stream_decompress40;
+        }
+        if (check) {
+                compress_or_decompress =
+                        compress_or_decompress == compress40
+                        ? check_compress40 : check_decompress40;
+        }
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
                 assert(fp != NULL);
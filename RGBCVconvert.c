@@ -16,125 +16,120 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "RGBCVconvert.h"
-#include "assert.h"
-
-/****************************************************************
- * RGBtoCV
- * Description: Convert RGB values to component video values
- * Inputs: 1) PPM image
- *         2) blocksize used for array
- * Output: 2D unboxed array with component video values stored
- * Implementation: Allocate memory for 2D unboxed array and
- *                 use map_block_major to get component video
- *                 values from RGB values of an image
- *****************************************************************/
-A2Methods_UArray2 RGBtoCV(Pnm_ppm image, int blocksize)
+#include "simd.h"
+#include "dispatch.h"
+
+/* 
+ * Conversion matrices. The SIMD kernels do the same float division
+ * and the same double precision products and sums, in the same
+ * order, as the scalar code, so every kernel gives identical
+ * results. Each row is applied as (k0 * x0 + k1 * x1) + k2 * x2.
+ */
+const double RGB_TO_Y[3] = { 0.299, 0.587, 0.114 };
+const double RGB_TO_PB[3] = { -0.168736, -0.331264, 0.5 };
+const double RGB_TO_PR[3] = { 0.5, -0.418688, -0.081312 };
+const double CV_TO_R[3] = { 1.0, 0.0, 1.402 };
+const double CV_TO_G[3] = { 1.0, -0.344136, -0.714136 };
+const double CV_TO_B[3] = { 1.0, 1.772, 0.0 };
+
+static inline float dot3(const double k[3], float x0, float x1, float x2)
 {
-    A2Methods_UArray2 CVarray = image->methods->
-                                new_with_blocksize(image->width,
-                                                   image->height,
-                                                   sizeof(CV),
-                                                   blocksize);
-    assert(CVarray != NULL);
-    /* for each pixel perform computation to convert RGB values
-     * to component video values */
-    image->methods->map_block_major(CVarray, RGBtoCV_apply, image);
-
-    return CVarray;
+    return k[0] * x0 + k[1] * x1 + k[2] * x2;
 }
 
+static void RGBtoCV_scalar(const unsigned red[], const unsigned green[],
+                           const unsigned blue[], unsigned denominator,
+                           int lo, int n, float y[], float pb[], float pr[]);
+/* batch kernels, one per tier; each converts whole vectors from
+ * the start of the run and returns how many values it converted */
+typedef int RGBtoCV_kernel(const unsigned red[], const unsigned green[],
+                           const unsigned blue[], unsigned denominator,
+                           int n, float y[], float pb[], float pr[]);
+
+#ifdef HAVE_X86_SIMD
+static RGBtoCV_kernel RGBtoCV_sse2, RGBtoCV_avx2, RGBtoCV_avx512;
+
+static RGBtoCV_kernel *const RGBtoCV_kernels[TIER_COUNT] = {
+    NULL, RGBtoCV_sse2, RGBtoCV_avx2, RGBtoCV_avx512
+};
+#else
+static RGBtoCV_kernel *const RGBtoCV_kernels[TIER_COUNT] = { NULL };
+#endif
+
 /****************************************************************
- * RGBtoCV_apply
- * Description: Apply function for RGBtoCV_apply
- * Inputs: 1) Column index
- *         2) Row index
- *         3) 2D array that is mapped
- *         4) Value at current index of 2D array
- *         5) Pointer to closure
+ * RGBtoCV_batch
+ * Description: Convert a run of pixels to component video values
+ * Inputs: 1) Red, green and blue values of the pixels, each
+ *            in its own array
+ *         2) Denominator of the image
+ *         3) Number of pixels
+ *         4) Arrays the y, pb and pr values are stored in
  * Output: Void
- * Implementation: Get RGB values from a pixel of an image and
- *                 perform calculation to derive component
- *                 video values y, pb, pr, and store them
- *                 in the 2D array.
+ * Implementation: Convert 16, 8 or 4 pixels at a time with the
+ *                 AVX-512, AVX2 or SSE2 kernel of the tier in use
+ *                 and finish the remaining pixels one by one.
  *****************************************************************/
-void RGBtoCV_apply(int i, int j, A2Methods_UArray2 array,
-                   void *elem, void *cl)
+void RGBtoCV_batch(const unsigned red[], const unsigned green[],
+                   const unsigned blue[], unsigned denominator, int n,
+                   float y[], float pb[], float pr[])
 {
-    (void) array;
-
-    Pnm_ppm image = (Pnm_ppm) cl;
-    Pnm_rgb pixel = (Pnm_rgb) image->methods->at(image->pixels, i, j);
+    int done = 0;
+    RGBtoCV_kernel *kernel = RGBtoCV_kernels[Dispatch_tier_in_use()];
 
-    float r = (float) pixel->red / (float) image->denominator;
-    float g = (float) pixel->green / (float) image->denominator;
-    float b = (float) pixel->blue / (float) image->denominator;
-
-    float y = 0.299 * r + 0.587 * g + 0.114 * b;
-    float pb = -0.168736 * r - 0.331264 * g + 0.5 * b;
-    float pr = 0.5 * r - 0.418688 * g - 0.081312 * b;
+    if (kernel != NULL)
+    {
+        done = kernel(red, green, blue, denominator, n, y, pb, pr);
+    }
 
-    /* store values into struct and assign to current pixel */
-    CV cv = { y, pb, pr };
-    *(CV *) elem = cv;
+    RGBtoCV_scalar(red, green, blue, denominator, done, n, y, pb, pr);
 }
 
 /****************************************************************
- * CVtoRGB
- * Description: Convert component video values to RGB values
- * Inputs: 1) 2D unboxed array (component video array in this case)
- *         2) PPM image
- *         3) blocksize used for array
+ * RGBtoCV_scalar
+ * Description: Convert pixels lo to n - 1 of a run one at a time
+ * Inputs: Same as RGBtoCV_batch, plus the first pixel to convert
  * Output: Void
- * Implementation: Allocate memory for pixmap ppm and map through
- *                 component video array to store RGB values in
- *                 pixmap.
+ * Implementation: Scale RGB values to between 0 and 1 and
+ *                 perform calculation to derive component
+ *                 video values y, pb, pr.
  *****************************************************************/
-void CVtoRGB(A2Methods_UArray2 array, Pnm_ppm pixmap, int blocksize)
+static void RGBtoCV_scalar(const unsigned red[], const unsigned green[],
+                           const unsigned blue[], unsigned denominator,
+                           int lo, int n, float y[], float pb[], float pr[])
 {
-    pixmap->pixels = pixmap->methods->
-                    new_with_blocksize(pixmap->width, pixmap->height,
-                                       sizeof(struct Pnm_rgb), blocksize);
-    assert(pixmap->pixels != NULL);
-
-    /* for each pixel perform computation to convert component 
-     * video values to RGB values */
-    pixmap->methods->map_block_major(array, CVtoRGB_apply, pixmap);
+    for (int i = lo; i < n; i++)
+    {
+        float r = (float) red[i] / (float) denominator;
+        float g = (float) green[i] / (float) denominator;
+        float b = (float) blue[i] / (float) denominator;
+
+        y[i] = dot3(RGB_TO_Y, r, g, b);
+        pb[i] = dot3(RGB_TO_PB, r, g, b);
+        pr[i] = dot3(RGB_TO_PR, r, g, b);
+    }
 }
 
 /****************************************************************
- * CVtoRGB_apply
- * Description: Apply function for CVtoRGB_apply
- * Inputs: 1) Column index
- *         2) Row index
- *         3) 2D array that is mapped
- *         4) Value at current index of 2D array
- *         5) Pointer to closure
- * Output: Void
- * Implementation: Get component video values from current index
- *                 of the array and perform calculation to derive
- *                 RGB values that is stored in pixmap pixel.
+ * CVtoRGB_pixel
+ * Description: Convert one component video value to an RGB pixel
+ * Inputs: 1) Pointer to component video value
+ *         2) Denominator of the output image
+ * Output: Struct of RGB pixel
+ * Implementation: Perform calculation to derive RGB values,
+ *                 clamp them between 0 and 1 and scale them by
+ *                 the denominator.
  *****************************************************************/
-void CVtoRGB_apply(int i, int j, A2Methods_UArray2 array,
-                   void *elem, void *cl)
+struct Pnm_rgb CVtoRGB_pixel(const CV *cv, unsigned denominator)
 {
-    (void) array;
-
-    Pnm_ppm pixmap = (Pnm_ppm) cl;
-    struct Pnm_rgb pixel;
-
-    float y = ((CV *) elem)->y;
-    float pb = ((CV *) elem)->pb;
-    float pr = ((CV *) elem)->pr;
+    float r = rgb_check(dot3(CV_TO_R, cv->y, cv->pb, cv->pr));
+    float g = rgb_check(dot3(CV_TO_G, cv->y, cv->pb, cv->pr));
+    float b = rgb_check(dot3(CV_TO_B, cv->y, cv->pb, cv->pr));
 
-    float r = rgb_check((1.0 * y) + (0.0 * pb) + (1.402 * pr));
-    float g = rgb_check((1.0 * y) - (0.344136 * pb) - (0.714136 * pr));
-    float b = rgb_check((1.0 * y) + (1.772 * pb) + (0.0 * pr));
+    struct Pnm_rgb pixel = { (unsigned) (r * denominator),
+                             (unsigned) (g * denominator),
+                             (unsigned) (b * denominator) };
 
-    /* store values into struct and assign to current pixel of pixmap */
-    pixel.red = (unsigned) (r * pixmap->denominator);
-    pixel.green = (unsigned) (g * pixmap->denominator);
-    pixel.blue = (unsigned) (b * pixmap->denominator);
-    *((struct Pnm_rgb *) pixmap->methods->at(pixmap->pixels, i, j)) = pixel;
+    return pixel;
 }
 
 /****************************************************************
@@ -158,4 +153,89 @@ float rgb_check(float value)
     }
 
     return value;
-}
\ No newline at end of file
+}
+
+#ifdef HAVE_X86_SIMD
+
+/*
+ * SIMD kernels. Each converts as many whole vectors as fit in n
+ * and returns how many values it converted.
+ */
+
+static int RGBtoCV_sse2(const unsigned red[], const unsigned green[],
+                        const unsigned blue[], unsigned denominator, int n,
+                        float y[], float pb[], float pr[])
+{
+    __m128 den = _mm_set1_ps((float) denominator);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m128 r = _mm_div_ps(_mm_cvtepi32_ps(
+                       _mm_loadu_si128((const __m128i *) &red[i])), den);
+        __m128 g = _mm_div_ps(_mm_cvtepi32_ps(
+                       _mm_loadu_si128((const __m128i *) &green[i])), den);
+        __m128 b = _mm_div_ps(_mm_cvtepi32_ps(
+                       _mm_loadu_si128((const __m128i *) &blue[i])), den);
+
+        _mm_storeu_ps(&y[i], dot3_sse2(RGB_TO_Y, r, g, b));
+        _mm_storeu_ps(&pb[i], dot3_sse2(RGB_TO_PB, r, g, b));
+        _mm_storeu_ps(&pr[i], dot3_sse2(RGB_TO_PR, r, g, b));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int RGBtoCV_avx2(const unsigned red[], const unsigned green[],
+                        const unsigned blue[], unsigned denominator, int n,
+                        float y[], float pb[], float pr[])
+{
+    __m256 den = _mm256_set1_ps((float) denominator);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(
+                       _mm256_loadu_si256((const __m256i *) &red[i])), den);
+        __m256 g = _mm256_div_ps(_mm256_cvtepi32_ps(
+                       _mm256_loadu_si256((const __m256i *) &green[i])), den);
+        __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(
+                       _mm256_loadu_si256((const __m256i *) &blue[i])), den);
+
+        _mm256_storeu_ps(&y[i], dot3_avx2(RGB_TO_Y, r, g, b));
+        _mm256_storeu_ps(&pb[i], dot3_avx2(RGB_TO_PB, r, g, b));
+        _mm256_storeu_ps(&pr[i], dot3_avx2(RGB_TO_PR, r, g, b));
+    }
+
+    return i + RGBtoCV_sse2(&red[i], &green[i], &blue[i], denominator,
+                            n - i, &y[i], &pb[i], &pr[i]);
+}
+
+__attribute__((target(AVX512)))
+static int RGBtoCV_avx512(const unsigned red[], const unsigned green[],
+                          const unsigned blue[], unsigned denominator, int n,
+                          float y[], float pb[], float pr[])
+{
+    __m512 den = _mm512_set1_ps((float) denominator);
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        __m512 r = _mm512_div_ps(_mm512_cvtepi32_ps(
+                       _mm512_loadu_si512(&red[i])), den);
+        __m512 g = _mm512_div_ps(_mm512_cvtepi32_ps(
+                       _mm512_loadu_si512(&green[i])), den);
+        __m512 b = _mm512_div_ps(_mm512_cvtepi32_ps(
+                       _mm512_loadu_si512(&blue[i])), den);
+
+        _mm512_storeu_ps(&y[i], dot3_avx512(RGB_TO_Y, r, g, b));
+        _mm512_storeu_ps(&pb[i], dot3_avx512(RGB_TO_PB, r, g, b));
+        _mm512_storeu_ps(&pr[i], dot3_avx512(RGB_TO_PR, r, g, b));
+    }
+
+    return i + RGBtoCV_avx2(&red[i], &green[i], &blue[i], denominator,
+                            n - i, &y[i], &pb[i], &pr[i]);
+}
+
+#endif
@@ -16,9 +16,6 @@
 #define RGBCVCONVERT_INCLUDED
 
 #include "pnm.h"
-#include "a2methods.h"
-#include "a2blocked.h"
-#include "uarray2b.h"
 
 /* struct holding info of component video */
 typedef struct
@@ -28,18 +25,21 @@ typedef struct
     float pr;
 } CV;
 
-/* converts RGB values to component video values in the array */
-A2Methods_UArray2 RGBtoCV(Pnm_ppm image, int blocksize);
-void RGBtoCV_apply(int i, int j, A2Methods_UArray2 array,
-                   void *elem, void *cl);
+/* conversion matrices, each row applied as
+ * (k[0] * x0 + k[1] * x1) + k[2] * x2 in double precision */
+extern const double RGB_TO_Y[3], RGB_TO_PB[3], RGB_TO_PR[3];
+extern const double CV_TO_R[3], CV_TO_G[3], CV_TO_B[3];
 
 /* check if rgb value is between 0 and 1 */
 float rgb_check(float value);
 
-/* converts component video values to RGB values in the array */
-void CVtoRGB(A2Methods_UArray2 array, Pnm_ppm pixmap,
-                int blocksize);
-void CVtoRGB_apply(int i, int j, A2Methods_UArray2 array,
-                   void *elem, void *cl);
+/* converts a single component video value to an RGB pixel */
+struct Pnm_rgb CVtoRGB_pixel(const CV *cv, unsigned denominator);
+
+/* converts n pixels held in separate red, green and blue planes
+ * to separate y, pb and pr planes, several pixels at a time */
+void RGBtoCV_batch(const unsigned red[], const unsigned green[],
+                   const unsigned blue[], unsigned denominator, int n,
+                   float y[], float pb[], float pr[]);
 
 #endif
\ No newline at end of file
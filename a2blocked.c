@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include <a2blocked.h>
+#include "a2blocks.h"
 #include "uarray2b.h"
 
 // define a private version of each function in A2Methods_T that we implement
@@ -51,6 +52,16 @@ static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
     UArray2b_map(array2, (applyfun *) apply, cl);
 }
 
+typedef void blockapplyfun(int i, int j, int width, int height,
+                           UArray2b_T array2b, void *cells, void *cl);
+
+// not a member of A2Methods_T, whose layout is the course's
+
+void A2Blocked_map_blocks(A2 array2, A2Blocked_applyfun apply, void *cl)
+{
+    UArray2b_map_blocks(array2, (blockapplyfun *) apply, cl);
+}
+
 struct small_closure {
     A2Methods_smallapplyfun *apply;
     void *cl;
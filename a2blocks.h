@@ -0,0 +1,37 @@
+/*************************************************************************
+*                              a2blocks.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Block-at-a-time mapping for the arrays of
+*               uarray2_methods_blocked, kept beside the course's
+*               A2Methods_T rather than added to it.
+*     
+**************************************************************************/
+
+#ifndef A2BLOCKS_INCLUDED
+#define A2BLOCKS_INCLUDED
+
+#include "a2methods.h"
+
+/*
+ * called once per block, with the column and row of the block's upper
+ * left cell and the width and height of the part of the block inside
+ * the array. The block's cells are contiguous, column by column:
+ * cell (i + x, j + y) is at cells + (x * blocksize + y) * size
+ */
+typedef void A2Blocked_applyfun(int i, int j, int width, int height,
+                                A2Methods_UArray2 array2,
+                                A2Methods_Object *cells, void *cl);
+
+/* visit each block of an array made by uarray2_methods_blocked once,
+ * in the order of its map_block_major */
+extern void A2Blocked_map_blocks(A2Methods_UArray2 array2,
+                                 A2Blocked_applyfun apply, void *cl);
+
+#endif
@@ -0,0 +1,54 @@
+/*************************************************************************
+*                             aligned.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file for cache line aligned allocations.
+*     
+**************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "except.h"
+#include "mem.h"
+#include "aligned.h"
+
+/****************************************************************
+ * Aligned_alloc
+ * Description: Allocate zeroed memory that starts on a cache line
+ * Inputs: 1) Number of bytes
+ * Output: Pointer to the memory
+ * Implementation: Allocate with posix_memalign and zero it, like
+ *                 CALLOC. An empty allocation still gets a byte,
+ *                 so the pointer can be freed like any other.
+ *                 Failure raises Mem_Failed, the exception the
+ *                 rest of the allocations raise.
+ *****************************************************************/
+void *Aligned_alloc(size_t len)
+{
+    void *ptr = NULL;
+
+    if (posix_memalign(&ptr, ALIGNED_LINE, len > 0 ? len : 1) != 0)
+    {
+        RAISE(Mem_Failed);
+    }
+    memset(ptr, 0, len);
+
+    return ptr;
+}
+
+/****************************************************************
+ * Aligned_free
+ * Description: Free memory from Aligned_alloc
+ * Inputs: 1) Pointer to the memory, or NULL
+ * Output: Void
+ *****************************************************************/
+void Aligned_free(void *ptr)
+{
+    free(ptr);
+}
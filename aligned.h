@@ -0,0 +1,31 @@
+/*************************************************************************
+*                             aligned.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for aligned.c, which hands out zeroed
+*               memory that starts on a cache line, for the cells of
+*               the 2d arrays.
+*     
+**************************************************************************/
+
+#ifndef ALIGNED_INCLUDED
+#define ALIGNED_INCLUDED
+
+#include <stddef.h>
+
+/* bytes in a cache line, which every allocation starts on */
+#define ALIGNED_LINE 64
+
+/* len bytes, all zero, starting on a cache line; running out of
+ * memory raises Mem_Failed, as ALLOC does */
+void *Aligned_alloc(size_t len);
+/* free memory from Aligned_alloc; NULL is ignored */
+void Aligned_free(void *ptr);
+
+#endif
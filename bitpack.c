@@ -290,4 +290,4 @@ int64_t right_shifts(int64_t word, unsigned width)
     {
         return ~0;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,79 @@
+/*************************************************************************
+*                          bitpack_unchecked.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Inline versions of the Bitpack get and new functions
+*               for callers that already know their fields are in
+*               range. Widths must be between 1 and 64 and fields
+*               must fit in 64 bits.
+*               Nothing is checked unless BITPACK_CHECKED is defined
+*               (add -DBITPACK_CHECKED to CFLAGS for a debug build),
+*               in which case bad widths are checked runtime errors
+*               and values that do not fit raise Bitpack_Overflow
+*               like Bitpack_newu and Bitpack_news do.
+*     
+**************************************************************************/
+
+#ifndef BITPACK_UNCHECKED_INCLUDED
+#define BITPACK_UNCHECKED_INCLUDED
+
+#include <stdint.h>
+#include "bitpack.h"
+
+#ifdef BITPACK_CHECKED
+#include "assert.h"
+#define BITPACK_CHECK_FIELD(width, lsb) \
+        assert((width) >= 1 && (width) <= 64 && (width) + (lsb) <= 64)
+#define BITPACK_CHECK_FITS(fits) \
+        do { if (!(fits)) RAISE(Bitpack_Overflow); } while (0)
+#else
+#define BITPACK_CHECK_FIELD(width, lsb) ((void) 0)
+#define BITPACK_CHECK_FITS(fits) ((void) 0)
+#endif
+
+/* mask of the low width bits */
+static inline uint64_t Bitpack_mask(unsigned width)
+{
+    return ~(uint64_t) 0 >> (64 - width);
+}
+
+static inline uint64_t Bitpack_getu_unchecked(uint64_t word, unsigned width,
+                                              unsigned lsb)
+{
+    BITPACK_CHECK_FIELD(width, lsb);
+    return (word >> lsb) & Bitpack_mask(width);
+}
+
+static inline int64_t Bitpack_gets_unchecked(uint64_t word, unsigned width,
+                                             unsigned lsb)
+{
+    BITPACK_CHECK_FIELD(width, lsb);
+    /* move the field to the top, then shift it back arithmetically */
+    return (int64_t) (word << (64 - width - lsb)) >> (64 - width);
+}
+
+static inline uint64_t Bitpack_newu_unchecked(uint64_t word, unsigned width,
+                                              unsigned lsb, uint64_t value)
+{
+    BITPACK_CHECK_FIELD(width, lsb);
+    BITPACK_CHECK_FITS(Bitpack_fitsu(value, width));
+    uint64_t mask = Bitpack_mask(width) << lsb;
+    return (word & ~mask) | ((value << lsb) & mask);
+}
+
+static inline uint64_t Bitpack_news_unchecked(uint64_t word, unsigned width,
+                                              unsigned lsb, int64_t value)
+{
+    BITPACK_CHECK_FIELD(width, lsb);
+    BITPACK_CHECK_FITS(Bitpack_fitss(value, width));
+    uint64_t mask = Bitpack_mask(width) << lsb;
+    return (word & ~mask) | (((uint64_t) value << lsb) & mask);
+}
+
+#endif
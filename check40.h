@@ -0,0 +1,27 @@
+/*************************************************************************
+*                             check40.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Self-check versions of compress40 and decompress40,
+*               which run every kernel tier the CPU supports, report
+*               any tier whose output differs from the scalar one on
+*               stderr, and otherwise write the usual output.
+*     
+**************************************************************************/
+
+#ifndef CHECK40_INCLUDED
+#define CHECK40_INCLUDED
+
+#include <stdio.h>
+
+/* both exit with status 1 if any tier disagrees */
+extern void check_compress40(FILE *input);
+extern void check_decompress40(FILE *input);
+
+#endif
@@ -0,0 +1,40 @@
+/*************************************************************************
+*                              chroma.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Tables for quantizing and dequantizing chroma values
+*               in the 40image program.
+*     
+**************************************************************************/
+
+#include "chroma.h"
+
+/* the arith40 library's chroma values */
+const float CHROMA_OF_INDEX[CHROMA_LEVELS] = {
+    -0.35, -0.20, -0.15, -0.10, -0.077, -0.055, -0.033, -0.011,
+    0.011, 0.033, 0.055, 0.077, 0.10, 0.15, 0.20, 0.35
+};
+
+/*
+ * Arith40_index_of_chroma picks the nearer of the two chroma values
+ * around its argument, comparing the two float differences and
+ * taking the upper value on a tie. Its answer only grows with its
+ * argument, so it is the number of these thresholds at or below the
+ * argument. Each one is the smallest float the library gives the
+ * upper index. Most are the float nearest to the midpoint of two
+ * values, but float rounding of the differences moves a few by an
+ * ulp. Between -0.011 and 0.011 both differences round to 0.011 for
+ * arguments from -2^-31 to 0, which makes -2^-31 the threshold there.
+ */
+const float CHROMA_THRESHOLDS[CHROMA_LEVELS - 1] = {
+    -0x1.199998p-2, -0x1.666666p-3, -0x1p-3, -0x1.6a7efap-4,
+    -0x1.0e5604p-4, -0x1.6872bp-5, -0x1.6872bp-6, -0x1p-31,
+    0x1.6872bp-6, 0x1.6872bp-5, 0x1.0e5604p-4, 0x1.6a7efap-4,
+    0x1.000002p-3, 0x1.666668p-3, 0x1.19999ap-2
+};
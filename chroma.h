@@ -0,0 +1,55 @@
+/*************************************************************************
+*                              chroma.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for chroma.c, with lookups that quantize
+*               and dequantize the average pb and pr of a block to
+*               and from a 4-bit index, giving exactly the results of
+*               Arith40_index_of_chroma and Arith40_chroma_of_index.
+*               The lookups are inline so the batch kernels use them
+*               without a call per block.
+*     
+**************************************************************************/
+
+#ifndef CHROMA_INCLUDED
+#define CHROMA_INCLUDED
+
+#include "assert.h"
+
+#define CHROMA_LEVELS 16
+
+/* chroma value of each index */
+extern const float CHROMA_OF_INDEX[CHROMA_LEVELS];
+/* smallest chroma value given each index from 1 on */
+extern const float CHROMA_THRESHOLDS[CHROMA_LEVELS - 1];
+
+/* chroma value of an index */
+static inline float Chroma_of_index(unsigned index)
+{
+    assert(index < CHROMA_LEVELS);
+    return CHROMA_OF_INDEX[index];
+}
+
+/* index of the chroma value nearest to a pb or pr value, found by
+ * a binary search of the thresholds */
+static inline unsigned Chroma_index_of(float value)
+{
+    unsigned index = 0;
+
+    for (unsigned step = CHROMA_LEVELS / 2; step > 0; step /= 2)
+    {
+        if (value >= CHROMA_THRESHOLDS[index + step - 1])
+        {
+            index += step;
+        }
+    }
+    return index;
+}
+
+#endif
@@ -15,35 +15,110 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include "a2methods.h"
-#include "a2blocked.h"
-#include "uarray2b.h"
+#include <string.h>
+#include <stdbool.h>
 #include "compress40.h"
+#include "check40.h"
+#include "stream40.h"
 #include "RGBCVconvert.h"
 #include "wordpack.h"
-#include "pnm.h"
+#include "layout.h"
+#include "order.h"
+#include "parallel.h"
+#include "dispatch.h"
+#include "raster.h"
+#include "tempmap.h"
 #include "assert.h"
 
 #define BLOCKSIZE 2
-
-/* struct holding info of 2D array's blocks,
- * array of codewords, and counter for each
- * pixel iterated during map process */
+/* number of codewords each thread byte-swaps at a time from a
+ * mapped file */
+#define CHUNK_WORDS 4096
+/* number of blocks whose pixels are converted together, one
+ * full vector of the widest (AVX-512) kernels */
+#define BATCH_BLOCKS 16
+/* number of block rows stream_compress40 reads and
+ * stream_decompress40 writes at a time */
+#define STREAM_BLOCK_ROWS 16
+/* longest line of keys a format 3 header may have */
+#define HEADER_KEYS_MAX 256
+
+/* struct holding info shared by the threads compressing
+ * bands of block rows of an image */
 typedef struct
 {
-    UArray_T block;
-    UArray_T codewords;
-    unsigned pix_count;
+    Raster_T image;
+    Layout_T layout;
+    uint32_t *codewords;
+    bool row_major;
+    int blocks_wide;
+    int blocks_high;
+    /* block row of the image the first row of the raster is in */
+    int first_row;
+    /* index of the codeword stored first in codewords */
+    size_t first_word;
 } codewords_cl;
 
-/* obtain codewords from 2D blocked array of component video value */
-UArray_T codewords(A2Methods_UArray2 CVarray, Pnm_ppm image);
-void codewords_apply(int i, int j, A2Methods_UArray2 array,
-                     void *elem, void *cl);
-/* obtain 2D blocked array of component video value from codewords */
-A2Methods_UArray2 words_to_cv(UArray_T words, Pnm_ppm image);
-void word_to_cv_apply(int i, int j, A2Methods_UArray2 array,
-                      void *elem, void *cl);
+/* read an image and trim it to whole blocks */
+Raster_T read_image(FILE *input);
+/* read the header of a compressed image */
+void read_header(FILE *input, unsigned *width, unsigned *height,
+                 Layout_T *layout, bool *row_major);
+/* obtain codewords directly from the RGB pixels of an image, in
+ * an array from Tempmap_alloc */
+uint32_t *codewords(Raster_T image, Layout_T layout, bool row_major);
+void codewords_band(unsigned lo, unsigned hi, void *cl);
+/* convert, transform and pack a run of blocks of an image */
+void compress_blocks(Raster_T image, Layout_T layout, int bx, int by,
+                     int n, uint64_t words[]);
+/* struct holding info shared by the threads decompressing
+ * ranges of codewords, which are either already read into an
+ * array or mapped from a regular file */
+typedef struct
+{
+    Raster_T image;
+    Layout_T layout;
+    uint32_t *codewords;
+    const unsigned char *mapped;
+    bool row_major;
+    int blocks_wide;
+    int blocks_high;
+    /* block row of the image the first row of the raster is in,
+     * and the number of block rows the raster holds */
+    int first_row;
+    int rows;
+    /* index of the codeword stored first in codewords or mapped */
+    size_t first_word;
+} words_cl;
+
+/* fill an image's samples directly from codewords */
+void words_to_rgb(words_cl *cl);
+void lines_to_rgb_band(unsigned lo, unsigned hi, void *cl);
+void decompress_range(words_cl *cl, size_t lo, size_t hi);
+/* unpack, transform and convert a run of blocks of an image */
+void decompress_blocks(words_cl *cl, const uint32_t words[], int n,
+                       size_t first);
+
+/* number of blocks, and so of codewords, of an image */
+static inline size_t block_count(unsigned width, unsigned height)
+{
+    return (size_t) (width / BLOCKSIZE) * (height / BLOCKSIZE);
+}
+
+/* index of the codeword of block (bx, by) of an image, whose
+ * blocks are stored column by column or row by row */
+static inline size_t block_index(bool row_major, unsigned bx,
+                                 unsigned by, unsigned blocks_wide,
+                                 unsigned blocks_high)
+{
+    return row_major ? (size_t) by * blocks_wide + bx
+                     : (size_t) bx * blocks_high + by;
+}
+
+/* index of the first differing codeword or pixel, -1 if none */
+long first_word_difference(const uint32_t words1[],
+                           const uint32_t words2[], size_t count);
+long first_pixel_difference(Raster_T image1, Raster_T image2);
 
 /****************************************************************
  * compress40
@@ -52,18 +127,154 @@ void word_to_cv_apply(int i, int j, A2Methods_UArray2 array,
  * Inputs: 1) File pointer to image file
  * Output: Void
  * Implementation: Read in file, check for dimensions of images,
- *                 convert RGB values to component video values,
- *                 get coded words from each blocks, and print out
- *                 result.
+ *                 get coded words from each block of RGB pixels
+ *                 in the layout and block order in use, and print
+ *                 out result.
  *****************************************************************/
 void compress40(FILE *input)
+{
+    Raster_T image = read_image(input);
+    Layout_T layout = Layout_in_use();
+    bool row_major = Order_row_major();
+
+    size_t count = block_count(image->width, image->height);
+
+    /* get list of codewords, one block at a time */
+    uint32_t *words = codewords(image, layout, row_major);
+    /* print out in specific format */
+    print_compressed(words, count, image->width, image->height, layout,
+                     row_major);
+
+    Tempmap_free(words, count * sizeof(uint32_t));
+    Raster_free(&image);
+}
+
+/****************************************************************
+ * check_compress40
+ * Description: Compress operation done when user inputs -c and
+ *              -check in command line.
+ * Inputs: 1) File pointer to image file
+ * Output: Void
+ * Implementation: Get the coded words of the image once with every
+ *                 kernel tier the CPU supports, and compare each
+ *                 set with the scalar one. Report each tier on
+ *                 stderr, print out the scalar words, and exit with
+ *                 status 1 if any tier disagreed.
+ *****************************************************************/
+void check_compress40(FILE *input)
+{
+    Raster_T image = read_image(input);
+    Layout_T layout = Layout_in_use();
+    bool row_major = Order_row_major();
+    size_t count = block_count(image->width, image->height);
+    Dispatch_tier best = Dispatch_best();
+    bool ok = true;
+
+    Dispatch_force(TIER_SCALAR);
+    uint32_t *expected = codewords(image, layout, row_major);
+
+    for (Dispatch_tier tier = TIER_SCALAR + 1; tier <= best; tier++)
+    {
+        Dispatch_force(tier);
+        uint32_t *words = codewords(image, layout, row_major);
+        long diff = first_word_difference(expected, words, count);
+        if (diff < 0)
+        {
+            fprintf(stderr, "compress: %s ok\n", Dispatch_name(tier));
+        }
+        else
+        {
+            fprintf(stderr, "compress: %s differs at codeword %ld\n",
+                    Dispatch_name(tier), diff);
+            ok = false;
+        }
+        Tempmap_free(words, count * sizeof(uint32_t));
+    }
+    Dispatch_force(best);
+
+    print_compressed(expected, count, image->width, image->height, layout,
+                     row_major);
+
+    Tempmap_free(expected, count * sizeof(uint32_t));
+    Raster_free(&image);
+    if (!ok)
+    {
+        exit(1);
+    }
+}
+
+/****************************************************************
+ * stream_compress40
+ * Description: Compress operation done when user inputs -c and
+ *              -stream in command line.
+ * Inputs: 1) File pointer to image file
+ * Output: Void
+ * Implementation: Read the image a strip of STREAM_BLOCK_ROWS
+ *                 block rows at a time into a raster that holds
+ *                 only that strip, and compress each strip's
+ *                 block rows on separate threads as codewords
+ *                 does. Blocks are always stored row by row, so
+ *                 each strip's coded words are printed as soon
+ *                 as they are done and only the strip and its
+ *                 words are ever in memory. The output is the
+ *                 same as compress40's with -order row. The last
+ *                 row of an odd height image is never read.
+ *****************************************************************/
+void stream_compress40(FILE *input)
 {
     assert(input != NULL);
 
-    A2Methods_T methods = uarray2_methods_blocked;
-    assert(methods != NULL);
+    Raster_T strip = Raster_open(input, STREAM_BLOCK_ROWS * BLOCKSIZE);
+    unsigned width = strip->width - strip->width % BLOCKSIZE;
+    unsigned height = strip->height - strip->height % BLOCKSIZE;
+    codewords_cl cl;
+    size_t count;
+
+    strip->width = width;
+    cl.image = strip;
+    cl.layout = Layout_in_use();
+    cl.row_major = true;
+    cl.blocks_wide = width / BLOCKSIZE;
+    cl.blocks_high = height / BLOCKSIZE;
+    count = (size_t) cl.blocks_wide * STREAM_BLOCK_ROWS;
+    cl.codewords = Tempmap_alloc(count * sizeof(uint32_t));
+
+    print_header(width, height, cl.layout, true);
+
+    for (cl.first_row = 0; cl.first_row < cl.blocks_high;
+         cl.first_row += STREAM_BLOCK_ROWS)
+    {
+        int rows = cl.blocks_high - cl.first_row;
+        if (rows > STREAM_BLOCK_ROWS)
+        {
+            rows = STREAM_BLOCK_ROWS;
+        }
+
+        Raster_read_rows(strip, input, rows * BLOCKSIZE);
+        cl.first_word = (size_t) cl.first_row * cl.blocks_wide;
+        Parallel_bands(rows, codewords_band, &cl);
+        print_words(cl.codewords, (size_t) rows * cl.blocks_wide);
+    }
+
+    Tempmap_free(cl.codewords, count * sizeof(uint32_t));
+    Raster_free(&strip);
+}
 
-    Pnm_ppm image = Pnm_ppmread(input, methods);
+/****************************************************************
+ * read_image
+ * Description: Read in the image to compress
+ * Inputs: 1) File pointer to image file
+ * Output: Raster of the image's samples
+ * Implementation: Read in file with the raster reader, which maps
+ *                 a P6 file rather than copying its pixels, and
+ *                 trim the last column and row of an odd length
+ *                 image.
+ *****************************************************************/
+Raster_T read_image(FILE *input)
+{
+    assert(input != NULL);
+
+    Raster_T image = Raster_read(input);
     assert(image != NULL);
 
     /* trim odd length image */
@@ -76,16 +287,7 @@ void compress40(FILE *input)
         (image->height)--;
     }
 
-    /* convert RGB values to component video */
-    A2Methods_UArray2 CVarray = RGBtoCV(image, BLOCKSIZE);
-    /* get list of codewords */
-    UArray_T words = codewords(CVarray, image);
-    /* print out in specific format */
-    print_compressed(words, image);
-
-    UArray_free(&words);
-    methods->free(&CVarray);
-    Pnm_ppmfree(&image);
+    return image;
 }
 
 /****************************************************************
@@ -94,181 +296,637 @@ void compress40(FILE *input)
  *              -c in command line.
  * Inputs: 1) File pointer to image file
  * Output: Void
- * Implementation: Read in file, extract coded words, convert
- *                 them to component video values, then convert
- *                 them to RGB values for each pixel, and print
- *                 out the result image.
+ * Implementation: Read in file header, extract coded words,
+ *                 convert each of them to the RGB values of its
+ *                 block on several threads with the layout the
+ *                 header names, straight into the rows of a P6
+ *                 raster, and print out the result image.
  *****************************************************************/
 void decompress40(FILE *input)
 {
-    assert(input != NULL);
+    unsigned height, width;
+    Layout_T layout;
+    bool row_major;
+    read_header(input, &width, &height, &layout, &row_major);
+
+    Raster_T image = Raster_new(width, height);
+    size_t count = block_count(width, height);
+    words_cl cl = { .image = image, .layout = layout,
+                    .codewords = NULL, .mapped = NULL,
+                    .row_major = row_major, .first_row = 0,
+                    .first_word = 0 };
+
+    /* codewords of a regular file are mapped and swapped by each
+     * thread as it needs them; anything else is read in full up
+     * front */
+    cl.mapped = map_compressed(input, count);
+    if (cl.mapped == NULL)
+    {
+        cl.codewords = read_compressed(input, count);
+    }
+    /* convert codewords to RGB values and store in image samples */
+    words_to_rgb(&cl);
+
+    Raster_write(stdout, image);
+
+    if (cl.codewords != NULL)
+    {
+        Tempmap_free(cl.codewords, count * sizeof(uint32_t));
+    }
+    else
+    {
+        unmap_compressed(cl.mapped, count);
+    }
+    Raster_free(&image);
+}
 
+/****************************************************************
+ * stream_decompress40
+ * Description: Decompress operation done when user inputs -d and
+ *              -stream in command line.
+ * Inputs: 1) File pointer to image file
+ * Output: Void
+ * Implementation: Print the P6 header, then decompress a strip of
+ *                 STREAM_BLOCK_ROWS block rows at a time into a
+ *                 raster that holds only that strip, and print the
+ *                 strip's rows right away. Blocks stored row by
+ *                 row are read a strip at a time and decompressed
+ *                 on separate threads by block row, so only the
+ *                 strip and its coded words are ever in memory.
+ *                 Blocks stored column by column are got at as
+ *                 decompress40 does and decompressed on separate
+ *                 threads by block column; a regular file keeps
+ *                 them in the page cache.
+ *****************************************************************/
+void stream_decompress40(FILE *input)
+{
     unsigned height, width;
-    int read = fscanf(input, "COMP40 Compressed image format 2\n%u %u", 
-                      &width, &height);
-    assert(read == 2);
-    int c =getc(input);
-    assert(c == '\n');
+    Layout_T layout;
+    bool row_major;
+    read_header(input, &width, &height, &layout, &row_major);
 
-    A2Methods_T methods = uarray2_methods_blocked;
-    assert(methods != NULL);
+    size_t count = block_count(width, height);
+    words_cl cl = { .layout = layout, .codewords = NULL, .mapped = NULL,
+                    .row_major = row_major, .first_word = 0 };
 
-    struct Pnm_ppm pixmap = { .width = width, .height = height,
-                              .denominator = 255, .pixels = NULL,
-                              .methods = methods
-                            };
+    cl.blocks_wide = width / BLOCKSIZE;
+    cl.blocks_high = height / BLOCKSIZE;
+    if (row_major)
+    {
+        /* only a strip's codewords are held at once */
+        count = (size_t) cl.blocks_wide * STREAM_BLOCK_ROWS;
+        cl.codewords = Tempmap_alloc(count * sizeof(uint32_t));
+    }
+    else
+    {
+        cl.mapped = map_compressed(input, count);
+        if (cl.mapped == NULL)
+        {
+            cl.codewords = read_compressed(input, count);
+        }
+    }
 
-    /* read compressed file and extract codewords */
-    UArray_T words = read_compressed(input, &pixmap, BLOCKSIZE);
-    /* convert codewords to coefficients values of component video */
-    A2Methods_UArray2 CVarray = words_to_cv(words, &pixmap);
-    /* convert component video to RGB values and store in pixmap pixel */
-    CVtoRGB(CVarray, &pixmap, BLOCKSIZE);
+    cl.image = Raster_open_write(stdout, width, height,
+                                 STREAM_BLOCK_ROWS * BLOCKSIZE);
 
-    Pnm_ppmwrite(stdout, &pixmap);
+    for (cl.first_row = 0; cl.first_row < cl.blocks_high;
+         cl.first_row += STREAM_BLOCK_ROWS)
+    {
+        cl.rows = cl.blocks_high - cl.first_row;
+        if (cl.rows > STREAM_BLOCK_ROWS)
+        {
+            cl.rows = STREAM_BLOCK_ROWS;
+        }
+
+        if (row_major)
+        {
+            cl.first_word = (size_t) cl.first_row * cl.blocks_wide;
+            read_words(input, cl.codewords,
+                       (size_t) cl.rows * cl.blocks_wide);
+            Parallel_bands(cl.rows, lines_to_rgb_band, &cl);
+        }
+        else
+        {
+            Parallel_bands(cl.blocks_wide, lines_to_rgb_band, &cl);
+        }
+        Raster_write_rows(cl.image, stdout, cl.rows * BLOCKSIZE);
+    }
 
-    UArray_free(&words);
-    methods->free(&CVarray);
-    methods->free(&(pixmap.pixels));
+    /* the last row of an odd height image has no blocks */
+    if (height % BLOCKSIZE != 0)
+    {
+        memset(cl.image->buffer, 0, cl.image->row_bytes);
+        Raster_write_rows(cl.image, stdout, 1);
+    }
 
+    if (cl.codewords != NULL)
+    {
+        Tempmap_free(cl.codewords, count * sizeof(uint32_t));
+    }
+    else
+    {
+        unmap_compressed(cl.mapped, count);
+    }
+    Raster_free(&cl.image);
 }
 
 /****************************************************************
- * codewords
- * Description: Get coded words from each block of component
- *              video array.
- * Inputs: 1) 2D unboxed array of with component video values
- *         2) PPM image file
- * Output: UArray_T unboxed array of coded words
- * Implementation: Allocate memory for block of component video
- *                 array and for coded words that will be stored
- *                 for each block. Map through the array to get
- *                 the desired coded words via block-major way.
+ * check_decompress40
+ * Description: Decompress operation done when user inputs -d and
+ *              -check in command line.
+ * Inputs: 1) File pointer to image file
+ * Output: Void
+ * Implementation: Read in all of the coded words, and convert them
+ *                 to RGB values once with every kernel tier the
+ *                 CPU supports, comparing each image with the
+ *                 scalar one. Report each tier on stderr, print
+ *                 out the scalar image, and exit with status 1 if
+ *                 any tier disagreed.
  *****************************************************************/
-UArray_T codewords(A2Methods_UArray2 CVarray, Pnm_ppm image)
+void check_decompress40(FILE *input)
 {
+    unsigned height, width;
+    Layout_T layout;
+    bool row_major;
+    read_header(input, &width, &height, &layout, &row_major);
+
+    Raster_T expected = Raster_new(width, height);
+    Raster_T image = Raster_new(width, height);
+    size_t count = block_count(width, height);
+    words_cl cl = { .image = expected, .layout = layout,
+                    .mapped = NULL, .row_major = row_major,
+                    .first_row = 0, .first_word = 0 };
+    cl.codewords = read_compressed(input, count);
+
+    Dispatch_tier best = Dispatch_best();
+    bool ok = true;
+
+    Dispatch_force(TIER_SCALAR);
+    words_to_rgb(&cl);
+
+    cl.image = image;
+    for (Dispatch_tier tier = TIER_SCALAR + 1; tier <= best; tier++)
+    {
+        Dispatch_force(tier);
+        words_to_rgb(&cl);
+        long diff = first_pixel_difference(expected, image);
+        if (diff < 0)
+        {
+            fprintf(stderr, "decompress: %s ok\n", Dispatch_name(tier));
+        }
+        else
+        {
+            fprintf(stderr, "decompress: %s differs at pixel %ld\n",
+                    Dispatch_name(tier), diff);
+            ok = false;
+        }
+    }
+    Dispatch_force(best);
+
+    Raster_write(stdout, expected);
 
+    Tempmap_free(cl.codewords, count * sizeof(uint32_t));
+    Raster_free(&image);
+    Raster_free(&expected);
+    if (!ok)
+    {
+        exit(1);
+    }
+}
+
+/****************************************************************
+ * read_header
+ * Description: Read in the header of a compressed image
+ * Inputs: 1) File pointer to compressed image file
+ *         2) Pointer to width to fill in
+ *         3) Pointer to height to fill in
+ *         4) Pointer to layout to fill in
+ *         5) Pointer to whether blocks are stored row by row, to
+ *            fill in
+ * Output: Void
+ * Implementation: Scan the header line and the dimensions, and
+ *                 the newline that ends them. A format 2 header
+ *                 ends there and its words have the default
+ *                 layout, stored column by column. A format 3
+ *                 header goes on with a line of space-separated
+ *                 key=value pairs, of which layout and order are
+ *                 known. Leave the file at the first coded word.
+ *                 An unknown format, key, layout or order is a
+ *                 checked runtime error.
+ *****************************************************************/
+void read_header(FILE *input, unsigned *width, unsigned *height,
+                 Layout_T *layout, bool *row_major)
+{
+    assert(input != NULL);
+
+    unsigned format;
+    int read = fscanf(input, "COMP40 Compressed image format %u\n%u %u",
+                      &format, width, height);
+    assert(read == 3);
+    assert(format == 2 || format == 3);
+    int c =getc(input);
+    assert(c == '\n');
+
+    *layout = Layout_default();
+    *row_major = false;
+    if (format == 2)
+    {
+        return;
+    }
+
+    char keys[HEADER_KEYS_MAX];
+    char *line = fgets(keys, sizeof(keys), input);
+    assert(line != NULL && strchr(line, '\n') != NULL);
+
+    char *save;
+    for (char *key = strtok_r(keys, " \n", &save); key != NULL;
+         key = strtok_r(NULL, " \n", &save))
+    {
+        char *value = strchr(key, '=');
+        assert(value != NULL);
+        *value++ = '\0';
+
+        if (strcmp(key, "layout") == 0)
+        {
+            bool known = Layout_parse(value, layout);
+            assert(known);
+        }
+        else if (strcmp(key, "order") == 0)
+        {
+            assert(strcmp(value, "row") == 0 ||
+                   strcmp(value, "column") == 0);
+            *row_major = strcmp(value, "row") == 0;
+        }
+        else
+        {
+            assert(0);
+        }
+    }
+}
+
+/****************************************************************
+ * codewords
+ * Description: Get coded words from each block of an image.
+ * Inputs: 1) Raster of the image
+ *         2) Layout to pack the coded words with
+ *         3) Whether to store blocks row by row
+ * Output: Array of 32bit coded words, from Tempmap_alloc
+ * Implementation: Allocate memory for coded words that will be
+ *                 stored for each block, which is a temporary
+ *                 file out of core. Split the block rows
+ *                 into bands that are compressed on separate
+ *                 threads, each block straight from its RGB
+ *                 pixels, so no component video array is built.
+ *****************************************************************/
+uint32_t *codewords(Raster_T image, Layout_T layout, bool row_major)
+{
     codewords_cl cl;
 
-    cl.block = UArray_new(BLOCKSIZE * BLOCKSIZE, sizeof(CV));
-    assert(cl.block != NULL);
-    cl.codewords = UArray_new((image->width * image->height) /
-                              (BLOCKSIZE * BLOCKSIZE), sizeof(uint64_t));
-    assert(cl.codewords != NULL);
-    cl.pix_count = 1;
-    /* get codewords for each block through block-major mapping */
-    image->methods->map_block_major(CVarray, codewords_apply, &cl);
+    cl.image = image;
+    cl.layout = layout;
+    cl.row_major = row_major;
+    cl.blocks_wide = image->width / BLOCKSIZE;
+    cl.blocks_high = image->height / BLOCKSIZE;
+    cl.first_row = 0;
+    cl.first_word = 0;
+    cl.codewords = Tempmap_alloc(block_count(image->width, image->height)
+                                 * sizeof(uint32_t));
+
+    Parallel_bands(cl.blocks_high, codewords_band, &cl);
 
-    UArray_free(&(cl.block));
     return cl.codewords;
 }
 
 /****************************************************************
- * codewords_apply
- * Description: Apply function for codewords
- * Inputs: 1) Column index
- *         2) Row index
- *         3) 2D array that is mapped
- *         4) Value at current index of 2D array
- *         5) Pointer to closure
+ * codewords_band
+ * Description: Band function for codewords
+ * Inputs: 1) First block row of the band, counted from the
+ *            first row of the raster
+ *         2) One past the last block row of the band
+ *         3) Pointer to closure
  * Output: Void
- * Implementation: At the beginning of each block, pack values
- *                 computed by discrete cosine transform operation
- *                 and pack them to get coded words. Then, store
- *                 the coded words into the array.
+ * Implementation: Compress the blocks of each block row of the
+ *                 band a run of side by side blocks at a time, so
+ *                 each run reads two contiguous stretches of
+ *                 pixels, and store each coded word at the index
+ *                 of its block in the order in use, so the output
+ *                 is the same however the rows are split between
+ *                 threads.
  *****************************************************************/
-void codewords_apply(int i, int j, A2Methods_UArray2 array,
-                     void *elem, void *cl)
+void codewords_band(unsigned lo, unsigned hi, void *cl)
 {
-    (void) array;
-
     codewords_cl *closure = cl;
-    unsigned pix_count = closure->pix_count;
-    unsigned block_id = BLOCKSIZE * (i % BLOCKSIZE) + (j % BLOCKSIZE);
-    *(CV *) UArray_at(closure->block, block_id) = *(CV *) elem;
-    /* perform dct and wordpack operation in the beginning
-     * of the block */
-    if (pix_count % (BLOCKSIZE * BLOCKSIZE) == 0)
+    uint64_t words[BATCH_BLOCKS];
+
+    for (int by = lo; by < (int) hi; by++)
+    {
+        for (int bx = 0; bx < closure->blocks_wide; bx += BATCH_BLOCKS)
+        {
+            int n = closure->blocks_wide - bx;
+            if (n > BATCH_BLOCKS)
+            {
+                n = BATCH_BLOCKS;
+            }
+
+            compress_blocks(closure->image, closure->layout, bx, by, n,
+                            words);
+
+            for (int k = 0; k < n; k++)
+            {
+                size_t codewords_id =
+                        block_index(closure->row_major, bx + k,
+                                    closure->first_row + by,
+                                    closure->blocks_wide,
+                                    closure->blocks_high)
+                        - closure->first_word;
+                closure->codewords[codewords_id] = words[k];
+            }
+        }
+    }
+}
+
+/****************************************************************
+ * compress_blocks
+ * Description: Fused encoder for a run of blocks in one row
+ * Inputs: 1) Raster of the image
+ *         2) Layout to pack the coded words with
+ *         3) Block column of the first block of the run
+ *         4) Block row of the run
+ *         5) Number of blocks, at most BATCH_BLOCKS
+ *         6) Array the coded words are stored in
+ * Output: Void
+ * Implementation: Gather the blocks' RGB pixels into small local
+ *                 arrays, reading each of the run's two rows of
+ *                 pixels from left to right and storing them cell
+ *                 by cell so each cell of the run's blocks is
+ *                 contiguous. Convert them all to component video
+ *                 values and transform them all at once, then pack
+ *                 each block into a coded word.
+ *                 8-bit images go through the fixed-point kernels
+ *                 instead when those are turned on.
+ *****************************************************************/
+void compress_blocks(Raster_T image, Layout_T layout, int bx, int by,
+                     int n, uint64_t words[])
+{
+    enum { CELLS = BLOCKSIZE * BLOCKSIZE, PIXELS = CELLS * BATCH_BLOCKS };
+    unsigned red[PIXELS], green[PIXELS], blue[PIXELS];
+    float y[PIXELS], pb[PIXELS], pr[PIXELS];
+    coeff cf[BATCH_BLOCKS];
+    assert(n > 0 && n <= BATCH_BLOCKS);
+
+    unsigned sample = image->sample_bytes;
+
+    /* cells are numbered column by column, as in a blocked array */
+    for (int r = 0; r < BLOCKSIZE; r++)
     {
-        /* codeword for the block */
-        uint64_t word = wordpack(dct(closure->block));
+        size_t row = (size_t) by * BLOCKSIZE + r;
+        const unsigned char *line = image->pixels + row * image->row_bytes
+                                    + (size_t) bx * BLOCKSIZE * 3 * sample;
+        for (int k = 0; k < n; k++)
+        {
+            for (int c = 0; c < BLOCKSIZE; c++)
+            {
+                int cell = c * BLOCKSIZE + r;
+                size_t col = (size_t) k * BLOCKSIZE + c;
+                const unsigned char *pixel = line + col * 3 * sample;
+                red[cell * n + k] = Raster_sample(image, pixel);
+                green[cell * n + k] = Raster_sample(image, pixel + sample);
+                blue[cell * n + k] = Raster_sample(image,
+                                                   pixel + 2 * sample);
+            }
+        }
+    }
 
-        unsigned codewords_id = (pix_count / (BLOCKSIZE * BLOCKSIZE)) - 1;
-        *(uint64_t *) UArray_at(closure->codewords, codewords_id) = word;
+    if (image->denominator == 255 && Dispatch_fixed_point())
+    {
+        layout->dct_fixed_batch(red, green, blue, n, cf);
+    }
+    else
+    {
+        RGBtoCV_batch(red, green, blue, image->denominator, n * CELLS,
+                      y, pb, pr);
+        layout->dct_batch(y, pb, pr, n, cf);
     }
 
-    (closure->pix_count)++;
+    layout->wordpack_batch(cf, n, words);
 }
 
 /****************************************************************
- * words_to_cv
- * Description: Convery coded words to component video values
- * Inputs: 1) Unboxed array of coded words
- *         2) PPM image
- * Output: 2D unboxed array with component video values
- * Implementation: Allocate memory for component video array
- *                 and map through it to get appropriate values
- *                 in by block-major way.
+ * words_to_rgb
+ * Description: Convert coded words to RGB values
+ * Inputs: 1) Pointer to closure holding the image and where its
+ *            coded words come from
+ * Output: Void
+ * Implementation: Split the block columns, or block rows if the
+ *                 blocks are stored row by row, into bands that
+ *                 are decompressed on separate threads, each block
+ *                 straight into its RGB samples. Every block is
+ *                 written, so the image can be reused.
  *****************************************************************/
-A2Methods_UArray2 words_to_cv(UArray_T words, Pnm_ppm pixmap)
+void words_to_rgb(words_cl *cl)
 {
-    A2Methods_UArray2 CVarray = pixmap->methods->
-                                new_with_blocksize(pixmap->width,
-                                                   pixmap->height,
-                                                   sizeof(CV), BLOCKSIZE);
-    assert(CVarray != NULL);
+    Raster_T image = cl->image;
 
-    codewords_cl cl;
-    cl.codewords = words;
-    cl.pix_count = 0;
+    cl->blocks_wide = image->width / BLOCKSIZE;
+    cl->blocks_high = image->height / BLOCKSIZE;
+    cl->first_row = 0;
+    cl->rows = cl->blocks_high;
 
-    pixmap->methods->map_block_major(CVarray, word_to_cv_apply, &cl);
-
-    return CVarray;
+    Parallel_bands(cl->row_major ? cl->blocks_high : cl->blocks_wide,
+                   lines_to_rgb_band, cl);
 }
 
 /****************************************************************
- * words_to_cv_apply
- * Description: Apply function for words_to_cv_apply
- * Inputs: 1) Column index
- *         2) Row index
- *         3) 2D array that is mapped
- *         4) Value at current index of 2D array
- *         5) Pointer to closure
+ * lines_to_rgb_band
+ * Description: Band function for words_to_rgb and
+ *              stream_decompress40
+ * Inputs: 1) First line of the band, a block column of the image
+ *            or, with blocks stored row by row, a block row of
+ *            the raster
+ *         2) One past the last line of the band
+ *         3) Pointer to closure
  * Output: Void
- * Implementation: At the beginning of block, perform unpacking
- *                 word to get coefficients and use them for
- *                 inverse discrete transformation. The array of
- *                 component video values will be stored in each
- *                 block.
+ * Implementation: The raster's blocks in one block column, or in
+ *                 one block row when they are stored row by row,
+ *                 are a run of consecutive codewords.
  *****************************************************************/
-void word_to_cv_apply(int i, int j, A2Methods_UArray2 array,
-                      void *elem, void *cl)
+void lines_to_rgb_band(unsigned lo, unsigned hi, void *cl)
 {
-    (void) array;
-    codewords_cl *closure = cl;
-    unsigned pix_count = closure->pix_count;
-    unsigned block_id = BLOCKSIZE * (i % BLOCKSIZE) + (j % BLOCKSIZE);
+    words_cl *closure = cl;
 
-    /* perform unpack and inverse_dct operation in the beginning
-     * of the block */
-    if (pix_count % (BLOCKSIZE * BLOCKSIZE) == 0)
+    for (unsigned line = lo; line < hi; line++)
     {
-        unsigned codewords_id = closure->pix_count / 4;
+        size_t first;
+        if (closure->row_major)
+        {
+            first = block_index(true, 0, closure->first_row + line,
+                                closure->blocks_wide, closure->blocks_high);
+            decompress_range(closure, first, first + closure->blocks_wide);
+        }
+        else
+        {
+            first = block_index(false, line, closure->first_row,
+                                closure->blocks_wide, closure->blocks_high);
+            decompress_range(closure, first, first + closure->rows);
+        }
+    }
+}
+
+/****************************************************************
+ * decompress_range
+ * Description: Decompress a range of codewords
+ * Inputs: 1) Pointer to closure
+ *         2) Index of first codeword of the range
+ *         3) One past the index of the last codeword of the range
+ * Output: Void
+ * Implementation: The block of each codeword follows from its
+ *                 index. Codewords read into an array are
+ *                 decompressed straight from it. Mapped ones are
+ *                 swapped a chunk at a time into a local array
+ *                 first.
+ *****************************************************************/
+void decompress_range(words_cl *closure, size_t lo, size_t hi)
+{
+    uint32_t chunk[CHUNK_WORDS];
 
-        uint64_t packword = *(uint64_t *) UArray_at(closure->codewords,
-                                                    codewords_id);
-        closure->block = inverse_dct(unpack(packword), BLOCKSIZE);
+    for (size_t first = lo; first < hi; first += CHUNK_WORDS)
+    {
+        size_t count = hi - first;
+        if (count > CHUNK_WORDS)
+        {
+            count = CHUNK_WORDS;
+        }
+
+        const uint32_t *words;
+        if (closure->mapped != NULL)
+        {
+            size_t byte = 4 * (first - closure->first_word);
+            swap_compressed(&closure->mapped[byte], count, chunk);
+            words = chunk;
+        }
+        else
+        {
+            words = &closure->codewords[first - closure->first_word];
+        }
+
+        for (size_t k = 0; k < count; k += BATCH_BLOCKS)
+        {
+            int n = count - k;
+            if (n > BATCH_BLOCKS)
+            {
+                n = BATCH_BLOCKS;
+            }
+            decompress_blocks(closure, &words[k], n, first + k);
+        }
     }
+}
 
-    *(CV *) elem = *(CV *) UArray_at(closure->block, block_id);
+/****************************************************************
+ * decompress_blocks
+ * Description: Fused decoder for a run of blocks
+ * Inputs: 1) Pointer to closure, with the layout of the coded
+ *            words and the raster they are decompressed into,
+ *            which has 8-bit samples
+ *         2) Coded words of the blocks
+ *         3) Number of blocks, at most BATCH_BLOCKS
+ *         4) Index of the first coded word of the run
+ * Output: Void
+ * Implementation: Decode all of the words straight to rows of
+ *                 8-bit RGB values at once. A block's two rows of
+ *                 two pixels are already in P6 order, so copy each
+ *                 into the raster at the block that follows from
+ *                 its word's index, counting block rows from the
+ *                 raster's first row. Use the fixed-point kernels
+ *                 when those are turned on.
+ *****************************************************************/
+void decompress_blocks(words_cl *cl, const uint32_t words[], int n,
+                       size_t first)
+{
+    Layout_T layout = cl->layout;
+    Raster_T image = cl->image;
+    enum { BLOCK_ROW_BYTES = 3 * BLOCKSIZE };
+    unsigned char top[BLOCK_ROW_BYTES * BATCH_BLOCKS];
+    unsigned char bottom[BLOCK_ROW_BYTES * BATCH_BLOCKS];
+    assert(n > 0 && n <= BATCH_BLOCKS);
+    assert(image->sample_bytes == 1);
+
+    if (Dispatch_fixed_point())
+    {
+        layout->inverse_dct_rgb_fixed_batch(words, n, top, bottom);
+    }
+    else
+    {
+        layout->inverse_dct_rgb_batch(words, n, top, bottom);
+    }
 
-    /* deallocate memory at the end of the block */
-    if (pix_count % (BLOCKSIZE * BLOCKSIZE) == 3)
+    for (int k = 0; k < n; k++)
     {
-        UArray_free(&(closure->block));
+        size_t index = first + k;
+        size_t bx, by;
+        if (cl->row_major)
+        {
+            bx = index % cl->blocks_wide;
+            by = index / cl->blocks_wide - cl->first_row;
+        }
+        else
+        {
+            bx = index / cl->blocks_high;
+            by = index % cl->blocks_high - cl->first_row;
+        }
+        unsigned char *row = image->buffer
+                             + by * BLOCKSIZE * image->row_bytes
+                             + bx * BLOCK_ROW_BYTES;
+        memcpy(row, &top[BLOCK_ROW_BYTES * k], BLOCK_ROW_BYTES);
+        memcpy(row + image->row_bytes, &bottom[BLOCK_ROW_BYTES * k],
+               BLOCK_ROW_BYTES);
     }
+}
 
-    (closure->pix_count)++;
+/****************************************************************
+ * first_word_difference
+ * Description: Compare two arrays of coded words
+ * Inputs: 1) First array of coded words
+ *         2) Second array of coded words
+ *         3) Number of words in each array
+ * Output: Index of the first word that differs, -1 if none does
+ * Implementation: Walk both arrays in step.
+ *****************************************************************/
+long first_word_difference(const uint32_t words1[],
+                           const uint32_t words2[], size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (words1[i] != words2[i])
+        {
+            return i;
+        }
+    }
+    return -1;
 }
 
+/****************************************************************
+ * first_pixel_difference
+ * Description: Compare the pixels of two images
+ * Inputs: 1) First image made with Raster_new
+ *         2) Second image made with Raster_new, of the same size
+ * Output: Row-major index of the first pixel that differs, -1 if
+ *         none does
+ * Implementation: Both rasters hold their rows with no gap between
+ *                 them, so walk their samples in step, and the
+ *                 first differing sample gives the pixel.
+ *****************************************************************/
+long first_pixel_difference(Raster_T image1, Raster_T image2)
+{
+    assert(image1->width == image2->width &&
+           image1->height == image2->height);
+
+    size_t len = image1->row_bytes * image1->height;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (image1->pixels[i] != image2->pixels[i])
+        {
+            return i / 3;
+        }
+    }
+    return -1;
+}
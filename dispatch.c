@@ -0,0 +1,175 @@
+/*************************************************************************
+*                             dispatch.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file that picks which instruction set
+*               tier of the batch kernels is used, from what the CPU
+*               supports or from the command line.
+*     
+**************************************************************************/
+
+#include <string.h>
+#include <pthread.h>
+#include "assert.h"
+#include "dispatch.h"
+#include "simd.h"
+
+static const char *tier_names[TIER_COUNT] = {
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+static Dispatch_tier tier_in_use = TIER_SCALAR;
+static pthread_once_t tier_once = PTHREAD_ONCE_INIT;
+static bool fixed_point = false;
+
+static void pick_best(void);
+
+/****************************************************************
+ * Dispatch_best
+ * Description: Find the best tier the CPU supports
+ * Inputs: None
+ * Output: Best tier
+ * Implementation: Ask cpuid, through gcc's builtin, which also
+ *                 checks that the OS saves the wider registers.
+ *                 The AVX-512 kernels need both the foundation
+ *                 and the byte and word instructions.
+ *****************************************************************/
+Dispatch_tier Dispatch_best(void)
+{
+#ifdef HAVE_X86_SIMD
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw"))
+    {
+        return TIER_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return TIER_AVX2;
+    }
+    return TIER_SSE2;
+#else
+    return TIER_SCALAR;
+#endif
+}
+
+/****************************************************************
+ * Dispatch_tier_in_use
+ * Description: Get the tier the batch kernels use
+ * Inputs: None
+ * Output: Tier in use
+ * Implementation: Detect the best tier once, on first use.
+ *****************************************************************/
+Dispatch_tier Dispatch_tier_in_use(void)
+{
+    pthread_once(&tier_once, pick_best);
+    return tier_in_use;
+}
+
+/****************************************************************
+ * Dispatch_force
+ * Description: Force the batch kernels to use a given tier
+ * Inputs: 1) Tier, which the CPU must support
+ * Output: Void
+ *****************************************************************/
+void Dispatch_force(Dispatch_tier tier)
+{
+    assert(tier < TIER_COUNT && tier <= Dispatch_best());
+
+    pthread_once(&tier_once, pick_best);
+    tier_in_use = tier;
+}
+
+/****************************************************************
+ * Dispatch_bmi2
+ * Description: Find out whether to pack and unpack codewords with
+ *              BMI2 instructions
+ * Inputs: None
+ * Output: Whether to use pext and pdep
+ * Implementation: Use them with the AVX2 tier or better, so that
+ *                 forcing a lower tier also turns them off, and
+ *                 only if the CPU has BMI2. AMD families 15h and
+ *                 17h have BMI2 but run pext and pdep in
+ *                 microcode, far slower than the portable code.
+ *****************************************************************/
+bool Dispatch_bmi2(void)
+{
+#ifdef HAVE_X86_SIMD
+    return Dispatch_tier_in_use() >= TIER_AVX2 &&
+           __builtin_cpu_supports("bmi2") &&
+           !__builtin_cpu_is("amdfam15h") && !__builtin_cpu_is("amdfam17h");
+#else
+    return false;
+#endif
+}
+
+/****************************************************************
+ * Dispatch_set_fixed_point
+ * Description: Choose between the float and the fixed-point
+ *              kernels for 8-bit images
+ * Inputs: 1) Whether to use the fixed-point kernels
+ * Output: Void
+ *****************************************************************/
+void Dispatch_set_fixed_point(bool on)
+{
+    fixed_point = on;
+}
+
+/****************************************************************
+ * Dispatch_fixed_point
+ * Description: Find out whether 8-bit images use the fixed-point
+ *              kernels
+ * Inputs: None
+ * Output: Whether the fixed-point kernels are used
+ *****************************************************************/
+bool Dispatch_fixed_point(void)
+{
+    return fixed_point;
+}
+
+/****************************************************************
+ * Dispatch_name
+ * Description: Get the name of a tier
+ * Inputs: 1) Tier
+ * Output: Name used on the command line
+ *****************************************************************/
+const char *Dispatch_name(Dispatch_tier tier)
+{
+    assert(tier < TIER_COUNT);
+    return tier_names[tier];
+}
+
+/****************************************************************
+ * Dispatch_parse
+ * Description: Find the tier with a given name
+ * Inputs: 1) Name of tier
+ *         2) Pointer the tier is stored in
+ * Output: Whether the name was found
+ *****************************************************************/
+bool Dispatch_parse(const char *name, Dispatch_tier *tier)
+{
+    for (int t = 0; t < TIER_COUNT; t++)
+    {
+        if (strcmp(name, tier_names[t]) == 0)
+        {
+            *tier = t;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/****************************************************************
+ * pick_best
+ * Description: Start out using the best tier the CPU supports
+ *****************************************************************/
+static void pick_best(void)
+{
+    tier_in_use = Dispatch_best();
+}
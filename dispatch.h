@@ -0,0 +1,52 @@
+/*************************************************************************
+*                             dispatch.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for dispatch.c
+*     
+**************************************************************************/
+
+#ifndef DISPATCH_INCLUDED
+#define DISPATCH_INCLUDED
+
+#include <stdbool.h>
+
+/* instruction set tiers of the batch kernels, each one a superset
+ * of the tiers before it */
+typedef enum
+{
+    TIER_SCALAR = 0,
+    TIER_SSE2,
+    TIER_AVX2,
+    TIER_AVX512,
+    TIER_COUNT
+} Dispatch_tier;
+
+/* best tier the CPU supports */
+Dispatch_tier Dispatch_best(void);
+/* tier the batch kernels use, the best one unless forced */
+Dispatch_tier Dispatch_tier_in_use(void);
+/* force a tier; forcing one the CPU lacks is a checked runtime error */
+void Dispatch_force(Dispatch_tier tier);
+
+/* whether codewords are packed and unpacked with BMI2's pext and
+ * pdep, which is so when the tier in use is AVX2 or better and the
+ * CPU has fast BMI2 */
+bool Dispatch_bmi2(void);
+
+/* whether 8-bit images go through the fixed-point kernels, which
+ * are off unless asked for */
+void Dispatch_set_fixed_point(bool on);
+bool Dispatch_fixed_point(void);
+
+/* name of a tier, and the tier with a given name */
+const char *Dispatch_name(Dispatch_tier tier);
+bool Dispatch_parse(const char *name, Dispatch_tier *tier);
+
+#endif
@@ -0,0 +1,83 @@
+/*************************************************************************
+*                              layout.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file that keeps the list of codeword
+*               layouts and the one compress40 packs codewords with.
+*     
+**************************************************************************/
+
+#include <string.h>
+#include <stddef.h>
+#include "assert.h"
+#include "layout.h"
+
+/* defined by layout6.c and layout9.c */
+extern const struct Layout_T Layout_6, Layout_9;
+
+static Layout_T const layouts[] = { &Layout_6, &Layout_9 };
+
+static Layout_T layout_in_use = NULL;
+
+/****************************************************************
+ * Layout_default
+ * Description: Get the layout of codewords whose header does not
+ *              name one
+ * Inputs: None
+ * Output: The 6-6-6-6-4-4 layout, which 40image has always used
+ *         for format 2 headers
+ *****************************************************************/
+Layout_T Layout_default(void)
+{
+    return &Layout_6;
+}
+
+/****************************************************************
+ * Layout_set
+ * Description: Choose the layout compress40 packs codewords with
+ * Inputs: 1) Layout
+ * Output: Void
+ *****************************************************************/
+void Layout_set(Layout_T layout)
+{
+    assert(layout != NULL);
+    layout_in_use = layout;
+}
+
+/****************************************************************
+ * Layout_in_use
+ * Description: Get the layout compress40 packs codewords with
+ * Inputs: None
+ * Output: Layout set with Layout_set, else the default one
+ *****************************************************************/
+Layout_T Layout_in_use(void)
+{
+    return layout_in_use != NULL ? layout_in_use : Layout_default();
+}
+
+/****************************************************************
+ * Layout_parse
+ * Description: Find the layout with a given name
+ * Inputs: 1) Name of layout
+ *         2) Pointer the layout is stored in
+ * Output: Whether the name was found
+ *****************************************************************/
+bool Layout_parse(const char *name, Layout_T *layout)
+{
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++)
+    {
+        if (strcmp(name, layouts[i]->name) == 0)
+        {
+            *layout = layouts[i];
+            return true;
+        }
+    }
+
+    return false;
+}
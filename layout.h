@@ -0,0 +1,71 @@
+/*************************************************************************
+*                              layout.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for layout.c, with the codeword layouts
+*               40image knows. A layout sets the width of each field
+*               of a codeword and the number of steps a and b, c and
+*               d are quantized to. Every layout has its own copy of
+*               the packing, quantization and transform functions,
+*               compiled for its constants from wordpack_layout.inc.
+*     
+**************************************************************************/
+
+#ifndef LAYOUT_INCLUDED
+#define LAYOUT_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "wordpack.h"
+#include "RGBCVconvert.h"
+
+typedef const struct Layout_T *Layout_T;
+
+/* a layout's name and functions, which do what wordpack.h says for
+ * the fields of that layout */
+struct Layout_T
+{
+    /* widths of a, b, c, d, pb and pr, such as "9-5-5-5-4-4" */
+    const char *name;
+
+    /* pack the coeff values of n blocks into n codewords at once */
+    void (*wordpack_batch)(const coeff cf[], int n, uint64_t words[]);
+    /* perform discrete cosine transform on n blocks at once; cell c
+     * of block k is stored at index c * n + k of y, pb and pr */
+    void (*dct_batch)(const float y[], const float pb[], const float pr[],
+                      int n, coeff cf[]);
+    /* fixed-point version of RGBtoCV_batch and dct_batch together
+     * for 8-bit images, from red, green and blue values laid out as
+     * dct_batch's y, pb and pr */
+    void (*dct_fixed_batch)(const unsigned red[], const unsigned green[],
+                            const unsigned blue[], int n, coeff cf[]);
+
+    /* decode n side by side blocks straight to 8-bit RGB, storing the
+     * three bytes of each pixel of their top row of pixels in top and
+     * of their bottom row of pixels in bottom */
+    void (*inverse_dct_rgb_batch)(const uint32_t words[], int n,
+                                  unsigned char top[],
+                                  unsigned char bottom[]);
+    /* fixed-point version of inverse_dct_rgb_batch */
+    void (*inverse_dct_rgb_fixed_batch)(const uint32_t words[], int n,
+                                        unsigned char top[],
+                                        unsigned char bottom[]);
+};
+
+/* layout of codewords whose header does not name one */
+Layout_T Layout_default(void);
+
+/* layout compress40 packs codewords with, the default unless set */
+void Layout_set(Layout_T layout);
+Layout_T Layout_in_use(void);
+
+/* the layout with a given name */
+bool Layout_parse(const char *name, Layout_T *layout);
+
+#endif
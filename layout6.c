@@ -0,0 +1,25 @@
+/*************************************************************************
+*                              layout6.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: The 6-6-6-6-4-4 codeword layout of the challenge, with
+*               6 bits for each of a, b, c and d. a has 63 steps, and
+*               b, c and d keep the 50 steps of the standard layout.
+*     
+**************************************************************************/
+
+#define LAYOUT Layout_6
+#define LAYOUT_NAME "6-6-6-6-4-4"
+#define LAYOUT_A_WIDTH 6
+#define LAYOUT_BCD_WIDTH 6
+/* max value of bits with width of 6 is (2^6) - 1 = 63 */
+#define LAYOUT_A_COEFF 63
+#define LAYOUT_BCD_COEFF 50
+
+#include "wordpack_layout.inc"
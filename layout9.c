@@ -0,0 +1,25 @@
+/*************************************************************************
+*                              layout9.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: The 9-5-5-5-4-4 codeword layout of the assignment
+*               spec, with 9 bits and 511 steps for a, and 5 bits
+*               and 50 steps for each of b, c and d.
+*     
+**************************************************************************/
+
+#define LAYOUT Layout_9
+#define LAYOUT_NAME "9-5-5-5-4-4"
+#define LAYOUT_A_WIDTH 9
+#define LAYOUT_BCD_WIDTH 5
+/* max value of bits with width of 9 is (2^9) - 1 = 511 */
+#define LAYOUT_A_COEFF 511
+#define LAYOUT_BCD_COEFF 50
+
+#include "wordpack_layout.inc"
@@ -0,0 +1,42 @@
+/*************************************************************************
+*                               order.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file that keeps the order compress40
+*               stores blocks' codewords in. It is independent of the
+*               codeword layout, which layout.c keeps.
+*     
+**************************************************************************/
+
+#include "order.h"
+
+static bool row_major = false;
+
+/****************************************************************
+ * Order_set_row_major
+ * Description: Choose the order compress40 stores blocks in
+ * Inputs: 1) Whether to store blocks row by row instead of
+ *            column by column
+ * Output: Void
+ *****************************************************************/
+void Order_set_row_major(bool row_major_order)
+{
+    row_major = row_major_order;
+}
+
+/****************************************************************
+ * Order_row_major
+ * Description: Get the order compress40 stores blocks in
+ * Inputs: None
+ * Output: Whether blocks are stored row by row
+ *****************************************************************/
+bool Order_row_major(void)
+{
+    return row_major;
+}
@@ -0,0 +1,25 @@
+/*************************************************************************
+*                               order.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for order.c
+*     
+**************************************************************************/
+
+#ifndef ORDER_INCLUDED
+#define ORDER_INCLUDED
+
+#include <stdbool.h>
+
+/* order compress40 stores blocks' codewords in: column by column,
+ * as map_block_major visits them, unless set to row by row */
+void Order_set_row_major(bool row_major);
+bool Order_row_major(void);
+
+#endif
@@ -0,0 +1,249 @@
+/*************************************************************************
+*                             parallel.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file that splits work over a range of
+*               indices into bands handled by a pool of pthreads.
+*     
+**************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "parallel.h"
+
+/* requested number of threads, 0 meaning one per online core */
+static unsigned requested_threads = 0;
+
+/* struct holding the band handled by one thread */
+typedef struct
+{
+    unsigned lo;
+    unsigned hi;
+    Parallel_bandfun *work;
+    void *cl;
+} band;
+
+/*
+ * Worker threads, made once and parked on start between jobs. A job
+ * is published by filling in bands, setting next and unfinished and
+ * bumping generation; each thread, the caller included, then takes
+ * bands by index until none are left.
+ */
+static struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t start;       /* a job was published */
+    pthread_cond_t done;        /* the last band of a job finished */
+    unsigned workers;           /* threads besides the caller */
+    unsigned long generation;   /* number of jobs published */
+    band *bands;                /* room for workers + 1 bands */
+    unsigned nbands;
+    unsigned next;              /* index of the next band to take */
+    unsigned unfinished;        /* bands not yet finished */
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+           PTHREAD_COND_INITIALIZER, 0, 0, NULL, 0, 0, 0 };
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+/* serializes callers, as there is one job at a time */
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+/* set on pool threads, which run a nested call's bands themselves */
+static __thread bool in_worker = false;
+
+static void make_pool(void);
+static void *worker(void *arg);
+static void run_bands(void);
+
+/****************************************************************
+ * Parallel_set_threads
+ * Description: Set number of threads used by Parallel_bands
+ * Inputs: 1) Number of threads, or 0 for one per online core
+ * Output: Void
+ * Implementation: The threads are made on the first call of
+ *                 Parallel_bands, so setting the number has an
+ *                 effect only before then.
+ *****************************************************************/
+void Parallel_set_threads(unsigned nthreads)
+{
+    requested_threads = nthreads;
+}
+
+/****************************************************************
+ * Parallel_threads
+ * Description: Get number of threads used by Parallel_bands
+ * Inputs: None
+ * Output: Number of threads, at least 1
+ * Implementation: Return the requested number of threads, or
+ *                 the number of online cores if none was set.
+ *****************************************************************/
+unsigned Parallel_threads(void)
+{
+    if (requested_threads > 0)
+    {
+        return requested_threads;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1)
+    {
+        return 1;
+    }
+
+    return (unsigned) cores;
+}
+
+/****************************************************************
+ * Parallel_bands
+ * Description: Run work over [0, n) split into bands
+ * Inputs: 1) Number of indices to split
+ *         2) Function run on each band
+ *         3) Closure passed to each call of work
+ * Output: Void
+ * Implementation: Split the range into at most one contiguous
+ *                 band per thread, with sizes differing by at
+ *                 most one, and hand them to the pool, which is
+ *                 made on first use. The calling thread takes
+ *                 bands too, then waits for the rest to finish.
+ *                 Which band covers an index depends only on n
+ *                 and the thread count, so results written per
+ *                 index do not depend on scheduling.
+ *****************************************************************/
+void Parallel_bands(unsigned n, Parallel_bandfun work, void *cl)
+{
+    assert(work != NULL);
+
+    unsigned nthreads = Parallel_threads();
+    if (nthreads > n)
+    {
+        nthreads = n;
+    }
+    if (nthreads <= 1 || in_worker)
+    {
+        if (n > 0)
+        {
+            work(0, n, cl);
+        }
+        return;
+    }
+
+    pthread_once(&pool_once, make_pool);
+    if (nthreads > pool.workers + 1)
+    {
+        nthreads = pool.workers + 1;
+    }
+
+    pthread_mutex_lock(&job_lock);
+    pthread_mutex_lock(&pool.lock);
+
+    unsigned lo = 0;
+    for (unsigned t = 0; t < nthreads; t++)
+    {
+        unsigned len = n / nthreads + (t < n % nthreads ? 1 : 0);
+        pool.bands[t] = (band) { lo, lo + len, work, cl };
+        lo += len;
+    }
+    assert(lo == n);
+
+    pool.nbands = nthreads;
+    pool.next = 0;
+    pool.unfinished = nthreads;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.start);
+
+    run_bands();
+    while (pool.unfinished > 0)
+    {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&job_lock);
+}
+
+/****************************************************************
+ * make_pool
+ * Description: Make the worker threads
+ * Inputs: None
+ * Output: Void
+ * Implementation: Make one thread fewer than Parallel_threads,
+ *                 as the caller of Parallel_bands works too. The
+ *                 threads are detached and run until the program
+ *                 exits.
+ *****************************************************************/
+static void make_pool(void)
+{
+    unsigned nthreads = Parallel_threads();
+
+    pool.bands = CALLOC(nthreads, sizeof(band));
+    for (unsigned t = 1; t < nthreads; t++)
+    {
+        pthread_t thread;
+        int err = pthread_create(&thread, NULL, worker, NULL);
+        assert(err == 0);
+        pthread_detach(thread);
+    }
+    pool.workers = nthreads - 1;
+}
+
+/****************************************************************
+ * worker
+ * Description: Thread entry point of a pool thread
+ * Inputs: 1) Unused
+ * Output: Never returns
+ * Implementation: Wait on start for a job newer than the last one
+ *                 seen, then take its bands until none are left.
+ *****************************************************************/
+static void *worker(void *arg)
+{
+    (void) arg;
+    unsigned long seen = 0;
+
+    in_worker = true;
+    pthread_mutex_lock(&pool.lock);
+    for (;;)
+    {
+        while (pool.generation == seen)
+        {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        seen = pool.generation;
+        run_bands();
+    }
+
+    return NULL;
+}
+
+/****************************************************************
+ * run_bands
+ * Description: Take and run bands of the current job
+ * Inputs: None
+ * Output: Void
+ * Implementation: Called and returns with pool.lock held, which
+ *                 is let go while each band runs. Whoever finishes
+ *                 the last band signals done.
+ *****************************************************************/
+static void run_bands(void)
+{
+    while (pool.next < pool.nbands)
+    {
+        band b = pool.bands[pool.next++];
+
+        pthread_mutex_unlock(&pool.lock);
+        b.work(b.lo, b.hi, b.cl);
+        pthread_mutex_lock(&pool.lock);
+
+        if (--pool.unfinished == 0)
+        {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+}
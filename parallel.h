@@ -0,0 +1,31 @@
+/*************************************************************************
+*                             parallel.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for parallel.c
+*     
+**************************************************************************/
+
+#ifndef PARALLEL_INCLUDED
+#define PARALLEL_INCLUDED
+
+/* work done on the half-open range [lo, hi) of a band split */
+typedef void Parallel_bandfun(unsigned lo, unsigned hi, void *cl);
+
+/* set number of worker threads, 0 meaning one per online core */
+void Parallel_set_threads(unsigned nthreads);
+/* number of worker threads that will be used */
+unsigned Parallel_threads(void);
+
+/* split [0, n) into contiguous bands and run work on each band
+ * on a pool of threads made on the first call, returning when
+ * every band is done */
+void Parallel_bands(unsigned n, Parallel_bandfun work, void *cl);
+
+#endif
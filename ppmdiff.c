@@ -16,8 +16,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include "assert.h"
 #include "a2methods.h"
 #include "a2plain.h"
+#include "uarray2.h"
 #include "pnm.h"
 
 /* handles command line input */
@@ -95,9 +97,11 @@ FILE *process_file(char *argv)
  * Output: Void
  * Implementation: Iterate through each pixel by the width and
  *                 height of whichever is smaller in dimension.
- *                 Perform RGB difference for each pixel and
- *                 add their squared values to use to compute
- *                 difference E value.
+ *                 Pixels are read with the plain methods, so each
+ *                 row is a contiguous array of Pnm_rgb that is
+ *                 walked straight from UArray2_row. Perform RGB
+ *                 difference for each pixel and add their squared
+ *                 values to use to compute difference E value.
  *****************************************************************/
 void diff(Pnm_ppm ppm1, Pnm_ppm ppm2)
 {
@@ -117,12 +121,20 @@ void diff(Pnm_ppm ppm1, Pnm_ppm ppm2)
         small_height = ppm2->height;
     }
 
+    assert(ppm1->methods == uarray2_methods_plain &&
+           ppm2->methods == uarray2_methods_plain);
+    assert(UArray2_size(ppm1->pixels) == sizeof(struct Pnm_rgb) &&
+           UArray2_size(ppm2->pixels) == sizeof(struct Pnm_rgb));
+
     for (int j = 0; j < small_height; j++)
     {
+        const struct Pnm_rgb *row1 = UArray2_row(ppm1->pixels, j);
+        const struct Pnm_rgb *row2 = UArray2_row(ppm2->pixels, j);
+
         for (int i = 0; i < small_width; i++)
         {
-            Pnm_rgb pix1 = ppm1->methods->at(ppm1->pixels, i, j);
-            Pnm_rgb pix2 = ppm2->methods->at(ppm2->pixels, i, j);
+            const struct Pnm_rgb *pix1 = &row1[i];
+            const struct Pnm_rgb *pix2 = &row2[i];
 
             float r_diff = (((int) pix1->red / (float) denom1) - 
                             ((int) pix2->red) / (float) denom2);
@@ -0,0 +1,632 @@
+/*************************************************************************
+*                              raster.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file for a PPM reader that hands out
+*               the samples of a P6 image where they are in the file,
+*               mapped into memory, and parses P3 images on several
+*               threads. Images can also be read a few rows at a time,
+*               and rasters made to be written as P6 images.
+*     
+**************************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "assert.h"
+#include "mem.h"
+#include "raster.h"
+#include "parallel.h"
+#include "tempmap.h"
+
+/* bytes read from a pipe with one fread, to start with */
+#define READ_CHUNK (1 << 20)
+/* shortest P3 raster text split between threads */
+#define PARALLEL_TEXT (1 << 20)
+
+/* struct holding info shared by the threads parsing pieces of
+ * the text of a P3 raster */
+typedef struct
+{
+    const unsigned char *text;
+    /* piece p is text[starts[p]] up to text[starts[p + 1]] */
+    size_t *starts;
+    /* index of the first sample of each piece */
+    size_t *firsts;
+    unsigned char *samples;
+    size_t nsamples;
+    unsigned sample_bytes;
+    unsigned denominator;
+} plain_cl;
+
+static void load_input(FILE *fp, Raster_T raster,
+                       const unsigned char **data, size_t *len);
+static void release_input(Raster_T raster);
+static unsigned header_number(const unsigned char **p,
+                              const unsigned char *end);
+static unsigned char *read_plain(Raster_T raster, const unsigned char *text,
+                                 size_t len);
+static size_t scan_plain(plain_cl *cl, unsigned piece, bool store);
+static void count_band(unsigned lo, unsigned hi, void *cl);
+static void parse_band(unsigned lo, unsigned hi, void *cl);
+static unsigned stream_number(FILE *fp, unsigned max);
+
+/****************************************************************
+ * Raster_read
+ * Description: Read a P6 or P3 image
+ * Inputs: 1) File pointer to image file
+ * Output: Raster holding the image
+ * Implementation: Get the whole input in memory, mapped when it
+ *                 is a regular file, and read the header from it.
+ *                 A P6 raster is used where it is. A P3 raster is
+ *                 parsed into a buffer laid out like a P6 one, from
+ *                 Tempmap_alloc, and the input is let go. Anything that is not a PPM
+ *                 image, or a raster shorter than the header says,
+ *                 is a checked runtime error.
+ *****************************************************************/
+Raster_T Raster_read(FILE *fp)
+{
+    Raster_T raster;
+    const unsigned char *data;
+    size_t len;
+
+    assert(fp != NULL);
+    NEW(raster);
+    raster->map = NULL;
+    raster->map_len = 0;
+    raster->buffer = NULL;
+    raster->plain = false;
+
+    load_input(fp, raster, &data, &len);
+    const unsigned char *end = data + len;
+    assert(len >= 2 && data[0] == 'P' && (data[1] == '6' || data[1] == '3'));
+    bool plain = data[1] == '3';
+
+    const unsigned char *p = data + 2;
+    raster->width = header_number(&p, end);
+    raster->height = header_number(&p, end);
+    raster->denominator = header_number(&p, end);
+    assert(raster->width > 0 && raster->height > 0);
+    assert(raster->denominator > 0 && raster->denominator < 65536);
+    /* a single whitespace character ends the header */
+    assert(p < end && isspace(*p));
+    p++;
+
+    raster->sample_bytes = raster->denominator > 255 ? 2 : 1;
+    raster->row_bytes = (size_t) 3 * raster->sample_bytes * raster->width;
+
+    if (plain)
+    {
+        unsigned char *samples = read_plain(raster, p, end - p);
+        release_input(raster);
+        raster->map = samples;
+        raster->map_len = raster->row_bytes * raster->height;
+        raster->buffer = samples;
+        raster->pixels = samples;
+    }
+    else
+    {
+        assert((size_t) (end - p) >= raster->row_bytes * raster->height);
+        raster->pixels = p;
+    }
+
+    return raster;
+}
+
+/****************************************************************
+ * Raster_open
+ * Description: Start reading a P6 or P3 image a few rows at a
+ *              time
+ * Inputs: 1) File pointer to image file
+ *         2) Number of rows the raster holds at once
+ * Output: Raster with the image's header and room for the rows,
+ *         whose samples are read in with Raster_read_rows
+ * Implementation: Read the header with stdio, which leaves the
+ *                 file at the first sample, so the input can be a
+ *                 pipe and nothing but the rows is ever in memory.
+ *                 Anything that is not a PPM image is a checked
+ *                 runtime error.
+ *****************************************************************/
+Raster_T Raster_open(FILE *fp, unsigned rows)
+{
+    Raster_T raster;
+
+    assert(fp != NULL);
+    int magic = getc(fp);
+    int kind = getc(fp);
+    assert(magic == 'P' && (kind == '6' || kind == '3'));
+
+    NEW(raster);
+    raster->plain = kind == '3';
+    raster->width = stream_number(fp, UINT_MAX);
+    raster->height = stream_number(fp, UINT_MAX);
+    raster->denominator = stream_number(fp, 65535);
+    assert(raster->width > 0 && raster->height > 0);
+    assert(raster->denominator > 0);
+    /* a single whitespace character ends the header */
+    int c = getc(fp);
+    assert(c != EOF && isspace(c));
+
+    raster->sample_bytes = raster->denominator > 255 ? 2 : 1;
+    raster->row_bytes = (size_t) 3 * raster->sample_bytes * raster->width;
+    raster->map = NULL;
+    raster->map_len = 0;
+    raster->buffer = ALLOC(raster->row_bytes * (rows > 0 ? rows : 1));
+    raster->pixels = raster->buffer;
+
+    return raster;
+}
+
+/****************************************************************
+ * Raster_read_rows
+ * Description: Read the next rows of an image opened with
+ *              Raster_open
+ * Inputs: 1) Raster, with room for the rows
+ *         2) File pointer the raster was opened on
+ *         3) Number of rows to read
+ * Output: Void
+ * Implementation: Read P6 rows with a single fread. Parse P3
+ *                 rows one number at a time into the same layout.
+ *                 A raster shorter than the header says, or a
+ *                 number over the denominator, is a checked
+ *                 runtime error.
+ *****************************************************************/
+void Raster_read_rows(Raster_T raster, FILE *fp, unsigned count)
+{
+    size_t len = raster->row_bytes * count;
+
+    if (!raster->plain)
+    {
+        size_t got = fread(raster->buffer, 1, len, fp);
+        assert(got == len);
+        return;
+    }
+
+    size_t nsamples = len / raster->sample_bytes;
+    for (size_t i = 0; i < nsamples; i++)
+    {
+        unsigned value = stream_number(fp, raster->denominator);
+        if (raster->sample_bytes == 1)
+        {
+            raster->buffer[i] = value;
+        }
+        else
+        {
+            raster->buffer[2 * i] = value >> 8;
+            raster->buffer[2 * i + 1] = value & 0xff;
+        }
+    }
+}
+
+/****************************************************************
+ * Raster_new
+ * Description: Make a raster of 8-bit samples, with a denominator
+ *              of 255, to be filled in
+ * Inputs: 1) Width of the image
+ *         2) Height of the image
+ * Output: Raster whose samples are in its buffer, row by row with
+ *         no gap between rows, all starting at zero
+ * Implementation: The buffer comes from Tempmap_alloc, so it is a
+ *                 temporary file out of core.
+ *****************************************************************/
+Raster_T Raster_new(unsigned width, unsigned height)
+{
+    Raster_T raster;
+    size_t len = (size_t) 3 * width * height;
+
+    NEW(raster);
+    raster->width = width;
+    raster->height = height;
+    raster->denominator = 255;
+    raster->sample_bytes = 1;
+    raster->row_bytes = (size_t) 3 * width;
+    raster->map = Tempmap_alloc(len);
+    raster->map_len = len;
+    raster->plain = false;
+    raster->buffer = raster->map;
+    raster->pixels = raster->buffer;
+
+    return raster;
+}
+
+/****************************************************************
+ * Raster_write
+ * Description: Write a raster as a P6 image
+ * Inputs: 1) File pointer
+ *         2) Raster
+ * Output: Void
+ * Implementation: Print the header as Pnm_ppmwrite does, then all
+ *                 of the rows as Raster_write_rows does.
+ *****************************************************************/
+void Raster_write(FILE *fp, Raster_T raster)
+{
+    fprintf(fp, "P6\n%u %u\n%u\n", raster->width, raster->height,
+            raster->denominator);
+    Raster_write_rows(raster, fp, raster->height);
+}
+
+/****************************************************************
+ * Raster_open_write
+ * Description: Start writing a P6 image a few rows at a time
+ * Inputs: 1) File pointer
+ *         2) Width of the image
+ *         3) Height of the image
+ *         4) Number of rows the raster holds at once
+ * Output: Raster of 8-bit samples with a denominator of 255 and
+ *         room for the rows, all starting at zero, whose rows are
+ *         written with Raster_write_rows
+ * Implementation: Print the header as Raster_write does.
+ *****************************************************************/
+Raster_T Raster_open_write(FILE *fp, unsigned width, unsigned height,
+                           unsigned rows)
+{
+    Raster_T raster = Raster_new(width, rows);
+
+    raster->height = height;
+    fprintf(fp, "P6\n%u %u\n%u\n", width, height, raster->denominator);
+
+    return raster;
+}
+
+/****************************************************************
+ * Raster_write_rows
+ * Description: Write rows of a raster's samples
+ * Inputs: 1) Raster
+ *         2) File pointer
+ *         3) Number of rows to write, from the raster's first row
+ * Output: Void
+ * Implementation: Samples are already in P6 order, so rows with no
+ *                 gap between them go out with a single fwrite,
+ *                 and other rows with one fwrite each.
+ *****************************************************************/
+void Raster_write_rows(Raster_T raster, FILE *fp, unsigned count)
+{
+    size_t row_len = (size_t) 3 * raster->sample_bytes * raster->width;
+
+    if (row_len == raster->row_bytes)
+    {
+        size_t len = row_len * count;
+        size_t written = fwrite(raster->pixels, 1, len, fp);
+        assert(written == len);
+        return;
+    }
+
+    for (unsigned row = 0; row < count; row++)
+    {
+        size_t written = fwrite(raster->pixels + row * raster->row_bytes,
+                                1, row_len, fp);
+        assert(written == row_len);
+    }
+}
+
+/****************************************************************
+ * Raster_free
+ * Description: Free a raster
+ * Inputs: 1) Pointer to raster, which is set to NULL
+ * Output: Void
+ *****************************************************************/
+void Raster_free(Raster_T *raster)
+{
+    assert(raster != NULL && *raster != NULL);
+    release_input(*raster);
+    FREE(*raster);
+}
+
+/****************************************************************
+ * load_input
+ * Description: Get the rest of an input file in memory
+ * Inputs: 1) File pointer
+ *         2) Raster to record the memory in
+ *         3) Pointer to the first byte to fill in
+ *         4) Pointer to the number of bytes to fill in
+ * Output: Void
+ * Implementation: Map a regular file read-only. Read anything
+ *                 else, or a file that cannot be mapped, into a
+ *                 buffer that doubles whenever it fills up.
+ *****************************************************************/
+static void load_input(FILE *fp, Raster_T raster,
+                       const unsigned char **data, size_t *len)
+{
+    int fd = fileno(fp);
+    off_t offset = ftell(fp);
+    struct stat st;
+
+    if (fd >= 0 && offset >= 0 && fstat(fd, &st) == 0 &&
+        S_ISREG(st.st_mode) && st.st_size > offset)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            raster->map = map;
+            raster->map_len = st.st_size;
+            *data = (const unsigned char *) map + offset;
+            *len = st.st_size - offset;
+            return;
+        }
+    }
+
+    size_t size = READ_CHUNK;
+    size_t used = 0;
+    size_t got;
+    unsigned char *buffer = ALLOC(size);
+
+    while ((got = fread(buffer + used, 1, size - used, fp)) > 0)
+    {
+        used += got;
+        if (used == size)
+        {
+            size *= 2;
+            RESIZE(buffer, size);
+        }
+    }
+
+    raster->buffer = buffer;
+    *data = buffer;
+    *len = used;
+}
+
+/****************************************************************
+ * release_input
+ * Description: Let go of the memory a raster's samples are in
+ * Inputs: 1) Raster
+ * Output: Void
+ * Implementation: A mapped input file and a buffer from
+ *                 Tempmap_alloc are both unmapped; a buffer from
+ *                 Tempmap_alloc is also the raster's mapping, so it
+ *                 is not freed twice.
+ *****************************************************************/
+static void release_input(Raster_T raster)
+{
+    if (raster->buffer != NULL && raster->buffer != raster->map)
+    {
+        FREE(raster->buffer);
+    }
+    raster->buffer = NULL;
+    if (raster->map != NULL)
+    {
+        Tempmap_free(raster->map, raster->map_len);
+        raster->map = NULL;
+    }
+}
+
+/****************************************************************
+ * header_number
+ * Description: Read a number of a PPM header
+ * Inputs: 1) Pointer to the position to read at, which is moved
+ *            past the number
+ *         2) End of the input
+ * Output: The number
+ * Implementation: Skip whitespace and comments, which run from
+ *                 a '#' to the end of the line, then read digits.
+ *                 A missing or overlong number is a checked
+ *                 runtime error.
+ *****************************************************************/
+static unsigned header_number(const unsigned char **p,
+                              const unsigned char *end)
+{
+    const unsigned char *q = *p;
+
+    while (q < end && (isspace(*q) || *q == '#'))
+    {
+        if (*q == '#')
+        {
+            while (q < end && *q != '\n')
+            {
+                q++;
+            }
+        }
+        else
+        {
+            q++;
+        }
+    }
+    assert(q < end && isdigit(*q));
+
+    unsigned value = 0;
+    while (q < end && isdigit(*q))
+    {
+        assert(value <= (UINT_MAX - 9) / 10);
+        value = value * 10 + (*q - '0');
+        q++;
+    }
+
+    *p = q;
+    return value;
+}
+
+/****************************************************************
+ * read_plain
+ * Description: Parse the text of a P3 raster
+ * Inputs: 1) Raster, with its header filled in
+ *         2) Text of the raster
+ *         3) Length of the text
+ * Output: Buffer of samples laid out as in a P6 raster, from
+ *         Tempmap_alloc
+ * Implementation: Split long texts into one piece per thread,
+ *                 each starting on a new line so no number or
+ *                 comment is split. Count the numbers in every
+ *                 piece on their own threads, which gives the
+ *                 index of each piece's first sample, then parse
+ *                 every piece on its own thread. Numbers past the
+ *                 last sample are ignored; too few numbers, a
+ *                 number over the denominator or anything else in
+ *                 the text is a checked runtime error.
+ *****************************************************************/
+static unsigned char *read_plain(Raster_T raster, const unsigned char *text,
+                                 size_t len)
+{
+    unsigned pieces = len < PARALLEL_TEXT ? 1 : Parallel_threads();
+    plain_cl cl;
+
+    cl.text = text;
+    cl.nsamples = 3 * (size_t) raster->width * raster->height;
+    cl.sample_bytes = raster->sample_bytes;
+    cl.denominator = raster->denominator;
+    cl.samples = Tempmap_alloc(cl.nsamples * cl.sample_bytes);
+    cl.starts = CALLOC(pieces + 1, sizeof(size_t));
+    cl.firsts = CALLOC(pieces + 1, sizeof(size_t));
+
+    for (unsigned p = 1; p < pieces; p++)
+    {
+        size_t start = len / pieces * p;
+        if (start < cl.starts[p - 1])
+        {
+            start = cl.starts[p - 1];
+        }
+        while (start < len && text[start - 1] != '\n')
+        {
+            start++;
+        }
+        cl.starts[p] = start;
+    }
+    cl.starts[pieces] = len;
+
+    /* firsts holds each piece's count of numbers until it is
+     * summed into the index of each piece's first sample */
+    Parallel_bands(pieces, count_band, &cl);
+    size_t total = 0;
+    for (unsigned p = 0; p <= pieces; p++)
+    {
+        size_t count = cl.firsts[p];
+        cl.firsts[p] = total;
+        total += count;
+    }
+    assert(total >= cl.nsamples);
+    Parallel_bands(pieces, parse_band, &cl);
+
+    FREE(cl.starts);
+    FREE(cl.firsts);
+    return cl.samples;
+}
+
+/****************************************************************
+ * scan_plain
+ * Description: Count or parse the numbers of a piece of P3 text
+ * Inputs: 1) Pointer to closure
+ *         2) Index of the piece
+ *         3) Whether to store the numbers as samples
+ * Output: Number of numbers in the piece
+ *****************************************************************/
+static size_t scan_plain(plain_cl *cl, unsigned piece, bool store)
+{
+    const unsigned char *p = cl->text + cl->starts[piece];
+    const unsigned char *end = cl->text + cl->starts[piece + 1];
+    size_t index = cl->firsts[piece];
+    size_t count = 0;
+
+    while (p < end)
+    {
+        if (isspace(*p))
+        {
+            p++;
+        }
+        else if (*p == '#')
+        {
+            while (p < end && *p != '\n')
+            {
+                p++;
+            }
+        }
+        else
+        {
+            assert(isdigit(*p));
+            unsigned value = 0;
+            while (p < end && isdigit(*p))
+            {
+                value = value * 10 + (*p - '0');
+                assert(value <= cl->denominator);
+                p++;
+            }
+
+            if (store && index < cl->nsamples)
+            {
+                if (cl->sample_bytes == 1)
+                {
+                    cl->samples[index] = value;
+                }
+                else
+                {
+                    cl->samples[2 * index] = value >> 8;
+                    cl->samples[2 * index + 1] = value & 0xff;
+                }
+            }
+            index++;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* band functions for the two passes of read_plain */
+static void count_band(unsigned lo, unsigned hi, void *cl)
+{
+    plain_cl *closure = cl;
+    for (unsigned piece = lo; piece < hi; piece++)
+    {
+        closure->firsts[piece] = scan_plain(closure, piece, false);
+    }
+}
+
+static void parse_band(unsigned lo, unsigned hi, void *cl)
+{
+    plain_cl *closure = cl;
+    for (unsigned piece = lo; piece < hi; piece++)
+    {
+        scan_plain(closure, piece, true);
+    }
+}
+
+/****************************************************************
+ * stream_number
+ * Description: Read a number of a PPM file with stdio
+ * Inputs: 1) File pointer, which is left just past the number
+ *         2) Largest value the number may have
+ * Output: The number
+ * Implementation: Skip whitespace and comments, as header_number
+ *                 does, then read digits and put back the
+ *                 character after them. A missing number, or one
+ *                 over the largest value, is a checked runtime
+ *                 error.
+ *****************************************************************/
+static unsigned stream_number(FILE *fp, unsigned max)
+{
+    int c = getc_unlocked(fp);
+
+    while (c != EOF && (isspace(c) || c == '#'))
+    {
+        if (c == '#')
+        {
+            while (c != EOF && c != '\n')
+            {
+                c = getc_unlocked(fp);
+            }
+        }
+        else
+        {
+            c = getc_unlocked(fp);
+        }
+    }
+    assert(c != EOF && isdigit(c));
+
+    unsigned value = 0;
+    while (c != EOF && isdigit(c))
+    {
+        unsigned digit = c - '0';
+        assert(digit <= max && value <= (max - digit) / 10);
+        value = value * 10 + digit;
+        c = getc_unlocked(fp);
+    }
+    ungetc(c, fp);
+
+    return value;
+}
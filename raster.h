@@ -0,0 +1,77 @@
+/*************************************************************************
+*                              raster.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for raster.c, a PPM reader that keeps an
+*               image's samples as they are in a P6 file, interleaved
+*               red, green and blue, row by row. Regular P6 files are
+*               mapped into memory rather than copied.
+*     
+**************************************************************************/
+
+#ifndef RASTER_INCLUDED
+#define RASTER_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct Raster_T *Raster_T;
+
+struct Raster_T
+{
+    unsigned width, height, denominator;
+    /* bytes per sample: 1, or 2 big-endian bytes when the
+     * denominator is over 255 */
+    unsigned sample_bytes;
+    /* bytes from the start of one row to the start of the next */
+    size_t row_bytes;
+    /* samples of the first row */
+    const unsigned char *pixels;
+
+    /* where the samples are held, for Raster_free; a new raster's
+     * samples are written through buffer */
+    void *map;
+    size_t map_len;
+    unsigned char *buffer;
+    /* whether a raster read a few rows at a time is P3 text */
+    bool plain;
+};
+
+/* read a P6 or P3 image; anything else is a checked runtime error.
+ * width and height may be made smaller afterwards to drop the last
+ * columns or rows */
+Raster_T Raster_read(FILE *fp);
+/* start reading a P6 or P3 image a few rows at a time, into a
+ * buffer of the given number of rows; only the header is read */
+Raster_T Raster_open(FILE *fp, unsigned rows);
+/* read the next count rows of an opened image into its buffer, from
+ * the first row of the buffer on */
+void Raster_read_rows(Raster_T raster, FILE *fp, unsigned count);
+/* new raster of 8-bit samples, to be filled in through buffer */
+Raster_T Raster_new(unsigned width, unsigned height);
+/* write a raster as a P6 image */
+void Raster_write(FILE *fp, Raster_T raster);
+/* start writing a P6 image of 8-bit samples a few rows at a time,
+ * from a buffer of the given number of rows; only the header is
+ * written */
+Raster_T Raster_open_write(FILE *fp, unsigned width, unsigned height,
+                           unsigned rows);
+/* write the first count rows of the buffer as the next rows of an
+ * image opened with Raster_open_write */
+void Raster_write_rows(Raster_T raster, FILE *fp, unsigned count);
+void Raster_free(Raster_T *raster);
+
+/* value of the sample at p */
+static inline unsigned Raster_sample(Raster_T raster, const unsigned char *p)
+{
+    return raster->sample_bytes == 1 ? p[0] : (unsigned) p[0] << 8 | p[1];
+}
+
+#endif
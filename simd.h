@@ -0,0 +1,178 @@
+/*************************************************************************
+*                               simd.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Inline SIMD helpers shared by the codec's batch kernels.
+*               Every helper rounds exactly like the scalar code it
+*               stands in for, so all kernels give identical output.
+*     
+**************************************************************************/
+
+#ifndef SIMD_INCLUDED
+#define SIMD_INCLUDED
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
+
+#ifdef HAVE_X86_SIMD
+
+/* 
+ * (k0 * x0 + k1 * x1) + k2 * x2 with every lane widened to double
+ * for the products and sums, then narrowed back to float. The scalar
+ * code works in double because the conversion matrices are double,
+ * and doing the same here keeps the float path byte-identical to it
+ * at half the lanes of a float product. -fixed is the faster path,
+ * at the cost of output that can differ by a level.
+ */
+static inline __m128 dot3_sse2(const double k[3], __m128 x0, __m128 x1,
+                               __m128 x2)
+{
+    __m128d k0 = _mm_set1_pd(k[0]);
+    __m128d k1 = _mm_set1_pd(k[1]);
+    __m128d k2 = _mm_set1_pd(k[2]);
+    __m128d lo = _mm_add_pd(_mm_add_pd(_mm_mul_pd(k0, _mm_cvtps_pd(x0)),
+                                       _mm_mul_pd(k1, _mm_cvtps_pd(x1))),
+                            _mm_mul_pd(k2, _mm_cvtps_pd(x2)));
+    x0 = _mm_movehl_ps(x0, x0);
+    x1 = _mm_movehl_ps(x1, x1);
+    x2 = _mm_movehl_ps(x2, x2);
+    __m128d hi = _mm_add_pd(_mm_add_pd(_mm_mul_pd(k0, _mm_cvtps_pd(x0)),
+                                       _mm_mul_pd(k1, _mm_cvtps_pd(x1))),
+                            _mm_mul_pd(k2, _mm_cvtps_pd(x2)));
+    return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+/* rgb_check, scaling by the denominator and truncation */
+static inline __m128i scale_sse2(__m128 value, __m128 den)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()),
+                       _mm_set1_ps(1.0));
+    return _mm_cvttps_epi32(_mm_mul_ps(value, den));
+}
+
+/* round() of small values: truncate, then step away from zero
+ * when the dropped fraction is at least a half */
+static inline __m128i round_sse2(__m128 value)
+{
+    __m128i whole = _mm_cvttps_epi32(value);
+    __m128 frac = _mm_sub_ps(value, _mm_cvtepi32_ps(whole));
+    __m128i up = _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5)));
+    __m128i down = _mm_castps_si128(_mm_cmple_ps(frac,
+                                                 _mm_set1_ps(-0.5)));
+    /* comparison masks are -1 where true */
+    return _mm_add_epi32(_mm_sub_epi32(whole, up), down);
+}
+
+/* low 32 bits of the lane by lane product of two vectors, which
+ * SSE2 only has for the even lanes */
+static inline __m128i mullo_sse2(__m128i x, __m128i y)
+{
+    __m128i even = _mm_mul_epu32(x, y);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 dot3_avx2(const double k[3], __m256 x0, __m256 x1,
+                               __m256 x2)
+{
+    __m256d k0 = _mm256_set1_pd(k[0]);
+    __m256d k1 = _mm256_set1_pd(k[1]);
+    __m256d k2 = _mm256_set1_pd(k[2]);
+    __m256d lo = _mm256_add_pd(
+        _mm256_add_pd(
+            _mm256_mul_pd(k0, _mm256_cvtps_pd(_mm256_castps256_ps128(x0))),
+            _mm256_mul_pd(k1, _mm256_cvtps_pd(_mm256_castps256_ps128(x1)))),
+        _mm256_mul_pd(k2, _mm256_cvtps_pd(_mm256_castps256_ps128(x2))));
+    __m256d hi = _mm256_add_pd(
+        _mm256_add_pd(
+            _mm256_mul_pd(k0, _mm256_cvtps_pd(_mm256_extractf128_ps(x0, 1))),
+            _mm256_mul_pd(k1, _mm256_cvtps_pd(_mm256_extractf128_ps(x1, 1)))),
+        _mm256_mul_pd(k2, _mm256_cvtps_pd(_mm256_extractf128_ps(x2, 1))));
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)),
+                                _mm256_cvtpd_ps(hi), 1);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i scale_avx2(__m256 value, __m256 den)
+{
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()),
+                          _mm256_set1_ps(1.0));
+    return _mm256_cvttps_epi32(_mm256_mul_ps(value, den));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i round_avx2(__m256 value)
+{
+    __m256i whole = _mm256_cvttps_epi32(value);
+    __m256 frac = _mm256_sub_ps(value, _mm256_cvtepi32_ps(whole));
+    __m256i up = _mm256_castps_si256(_mm256_cmp_ps(frac,
+                                                   _mm256_set1_ps(0.5),
+                                                   _CMP_GE_OQ));
+    __m256i down = _mm256_castps_si256(_mm256_cmp_ps(frac,
+                                                     _mm256_set1_ps(-0.5),
+                                                     _CMP_LE_OQ));
+    return _mm256_add_epi32(_mm256_sub_epi32(whole, up), down);
+}
+
+#define AVX512 "avx512f,avx512bw"
+
+__attribute__((target(AVX512)))
+static inline __m512 dot3_avx512(const double k[3], __m512 x0, __m512 x1,
+                                 __m512 x2)
+{
+    __m512d k0 = _mm512_set1_pd(k[0]);
+    __m512d k1 = _mm512_set1_pd(k[1]);
+    __m512d k2 = _mm512_set1_pd(k[2]);
+    __m512d lo = _mm512_add_pd(
+        _mm512_add_pd(
+            _mm512_mul_pd(k0, _mm512_cvtps_pd(_mm512_castps512_ps256(x0))),
+            _mm512_mul_pd(k1, _mm512_cvtps_pd(_mm512_castps512_ps256(x1)))),
+        _mm512_mul_pd(k2, _mm512_cvtps_pd(_mm512_castps512_ps256(x2))));
+    __m512d hi = _mm512_add_pd(
+        _mm512_add_pd(
+            _mm512_mul_pd(k0, _mm512_cvtps_pd(_mm256_castpd_ps(
+                _mm512_extractf64x4_pd(_mm512_castps_pd(x0), 1)))),
+            _mm512_mul_pd(k1, _mm512_cvtps_pd(_mm256_castpd_ps(
+                _mm512_extractf64x4_pd(_mm512_castps_pd(x1), 1))))),
+        _mm512_mul_pd(k2, _mm512_cvtps_pd(_mm256_castpd_ps(
+            _mm512_extractf64x4_pd(_mm512_castps_pd(x2), 1)))));
+    __m512d both = _mm512_insertf64x4(
+        _mm512_castpd256_pd512(_mm256_castps_pd(_mm512_cvtpd_ps(lo))),
+        _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1);
+    return _mm512_castpd_ps(both);
+}
+
+__attribute__((target(AVX512)))
+static inline __m512i scale_avx512(__m512 value, __m512 den)
+{
+    value = _mm512_min_ps(_mm512_max_ps(value, _mm512_setzero_ps()),
+                          _mm512_set1_ps(1.0));
+    return _mm512_cvttps_epi32(_mm512_mul_ps(value, den));
+}
+
+__attribute__((target(AVX512)))
+static inline __m512i round_avx512(__m512 value)
+{
+    __m512i whole = _mm512_cvttps_epi32(value);
+    __m512 frac = _mm512_sub_ps(value, _mm512_cvtepi32_ps(whole));
+    __mmask16 up = _mm512_cmp_ps_mask(frac, _mm512_set1_ps(0.5),
+                                      _CMP_GE_OQ);
+    __mmask16 down = _mm512_cmp_ps_mask(frac, _mm512_set1_ps(-0.5),
+                                        _CMP_LE_OQ);
+    __m512i one = _mm512_set1_epi32(1);
+    whole = _mm512_mask_add_epi32(whole, up, whole, one);
+    return _mm512_mask_sub_epi32(whole, down, whole, one);
+}
+
+#endif
+#endif
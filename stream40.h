@@ -0,0 +1,26 @@
+/*************************************************************************
+*                             stream40.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Streaming versions of compress40 and decompress40,
+*               which read their input a strip of rows at a time
+*               instead of holding the whole image in memory, and
+*               otherwise write the usual output.
+*     
+**************************************************************************/
+
+#ifndef STREAM40_INCLUDED
+#define STREAM40_INCLUDED
+
+#include <stdio.h>
+
+extern void stream_compress40(FILE *input);
+extern void stream_decompress40(FILE *input);
+
+#endif
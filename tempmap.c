@@ -0,0 +1,118 @@
+/*************************************************************************
+*                             tempmap.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file that backs image-sized buffers with
+*               anonymous mappings or, out of core, with mapped
+*               temporary files.
+*     
+**************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "assert.h"
+#include "mem.h"
+#include "tempmap.h"
+
+static bool use_files = false;
+
+/****************************************************************
+ * Tempmap_set_files
+ * Description: Choose whether buffers are backed by files
+ * Inputs: 1) Whether to back buffers by temporary files
+ * Output: Void
+ *****************************************************************/
+void Tempmap_set_files(bool files)
+{
+    use_files = files;
+}
+
+/****************************************************************
+ * Tempmap_files
+ * Description: Get whether buffers are backed by files
+ * Inputs: None
+ * Output: Whether out-of-core mode is on
+ *****************************************************************/
+bool Tempmap_files(void)
+{
+    return use_files;
+}
+
+/****************************************************************
+ * Tempmap_alloc
+ * Description: Get the memory of an image-sized buffer
+ * Inputs: 1) Number of bytes
+ * Output: Buffer, all zero
+ * Implementation: Map fresh pages, which are zero. Out of core,
+ *                 make a temporary file, unlink it so it goes away
+ *                 with the mapping, reserve its blocks on disk and
+ *                 map it shared, so dirty pages are written back to
+ *                 it rather than to swap. Reserving the blocks up
+ *                 front makes a full disk fail here, as a checked
+ *                 runtime error, rather than with SIGBUS when a page
+ *                 is written back. An empty buffer still gets a
+ *                 byte, as mmap needs a length.
+ *****************************************************************/
+void *Tempmap_alloc(size_t len)
+{
+    void *buffer;
+
+    if (len == 0)
+    {
+        len = 1;
+    }
+
+    if (!use_files)
+    {
+        buffer = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(buffer != MAP_FAILED);
+        return buffer;
+    }
+
+    const char *dir = getenv("TMPDIR");
+    if (dir == NULL || *dir == '\0')
+    {
+        dir = "/tmp";
+    }
+    size_t dir_len = strlen(dir);
+    char *path = ALLOC(dir_len + sizeof("/40image.XXXXXX"));
+    memcpy(path, dir, dir_len);
+    strcpy(path + dir_len, "/40image.XXXXXX");
+
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    FREE(path);
+
+    int err = posix_fallocate(fd, 0, (off_t) len);
+    assert(err == 0);
+    buffer = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    assert(buffer != MAP_FAILED);
+    close(fd);
+
+    return buffer;
+}
+
+/****************************************************************
+ * Tempmap_free
+ * Description: Free a buffer from Tempmap_alloc
+ * Inputs: 1) Buffer
+ *         2) Number of bytes it was made with
+ * Output: Void
+ * Implementation: Unmap it, which also lets go of its file.
+ *****************************************************************/
+void Tempmap_free(void *buffer, size_t len)
+{
+    assert(buffer != NULL);
+    munmap(buffer, len > 0 ? len : 1);
+}
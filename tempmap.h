@@ -0,0 +1,35 @@
+/*************************************************************************
+*                             tempmap.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for tempmap.c, which hands out the memory
+*               of image-sized buffers. Buffers are anonymous mappings
+*               unless out-of-core mode is on, in which case each one
+*               is a mapped temporary file that the kernel can page
+*               out to disk.
+*     
+**************************************************************************/
+
+#ifndef TEMPMAP_INCLUDED
+#define TEMPMAP_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/* back later buffers with temporary files in $TMPDIR, or /tmp */
+void Tempmap_set_files(bool files);
+bool Tempmap_files(void);
+
+/* a buffer of len bytes, all zero; running out of memory or disk
+ * is a checked runtime error */
+void *Tempmap_alloc(size_t len);
+/* free a buffer from Tempmap_alloc, of the same length */
+void Tempmap_free(void *buffer, size_t len);
+
+#endif
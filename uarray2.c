@@ -12,75 +12,91 @@
 *     
 **************************************************************************/
 
-#line 50 "www/solutions/uarray2.nw"
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
+#include "aligned.h"
 #include "uarray2.h"
 
 #define T UArray2_T
 
 /* 
  * Element (i, j) in the world of ideas maps to
- * rows[j][i] where the square brackets stand for access
- * to a Hanson UArray_T
+ * cells[j * stride + i * size], in one contiguous allocation
+ * that starts on a cache line
  */
 struct T {
         int width, height;
         int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
+        size_t stride;  /* bytes from one row to the next: width * size,
+                           rounded up to whole cache lines when a row
+                           takes at least one */
+        char *cells;
 };
-#line 79 "www/solutions/uarray2.nw"
-static inline UArray_T row(T a, int j)
+
+static inline char *row(T a, int j)
 {
-        UArray_T *prow = UArray_at(a->rows, j);   /* Ramsey idiom */
-        return *prow;
+        return a->cells + (size_t) j * a->stride;
 }
-#line 92 "www/solutions/uarray2.nw"
+
 static int is_ok(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a && a->width >= 0 && a->height >= 0 && a->size > 0 &&
+               a->stride >= (size_t) a->width * a->size &&
+               (a->stride == (size_t) a->width * a->size ||
+                a->stride % ALIGNED_LINE == 0) && a->cells != NULL;
 }
-#line 109 "www/solutions/uarray2.nw"
+
 T UArray2_new(int width, int height, int size)
 {
-        int i;  /* interates over row number */
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
         T array;
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
+        array->stride = (size_t) width * size;
+        /* padding narrow rows would multiply their size */
+        if (array->stride >= ALIGNED_LINE) {
+                array->stride = (array->stride + ALIGNED_LINE - 1)
+                                / ALIGNED_LINE * ALIGNED_LINE;
         }
+
+        /* width * size fits a size_t; the product with the height
+         * may not */
+        size_t len;
+        int overflow = __builtin_mul_overflow(array->stride,
+                                              (size_t) height, &len);
+        assert(!overflow);
+
+        /* one allocation of every row, zeroed like a fresh UArray */
+        array->cells = Aligned_alloc(len);
         assert(is_ok(array));
         return array;
 }
-#line 131 "www/solutions/uarray2.nw"
+
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 && *array2);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        Aligned_free((*array2)->cells);
         FREE(*array2);
 }
-#line 151 "www/solutions/uarray2.nw"
+
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j) + (size_t) i * array2->size;
 }
-#line 162 "www/solutions/uarray2.nw"
+
+void *UArray2_row(T array2, int j)
+{
+        assert(array2);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j);
+}
+
 int UArray2_height(T array2)
 {
         assert(array2);
@@ -98,7 +114,7 @@ int UArray2_size(T array2)
         assert(array2);
         return array2->size;
 }
-#line 193 "www/solutions/uarray2.nw"
+
 void UArray2_map_row_major(T array2, 
                            void apply(int i, int j, T array2, 
                                       void *elem, void *cl), 
@@ -107,14 +123,15 @@ void UArray2_map_row_major(T array2,
         assert(array2);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
+        size_t size = array2->size;
         for (int j = 0; j < h; j++) {
-                /* don't want row/UArray_at in inner loop */
-                UArray_T thisrow = row(array2, j); 
-                for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                /* walk the row's cells with a pointer */
+                char *elem = row(array2, j); 
+                for (int i = 0; i < w; i++, elem += size)
+                        apply(i, j, array2, elem, cl);
         }
 }
-#line 211 "www/solutions/uarray2.nw"
+
 void UArray2_map_col_major(T array2, 
                            void apply(int i, int j, T array2, 
                                       void *elem, void *cl), 
@@ -123,7 +140,11 @@ void UArray2_map_col_major(T array2,
         assert(array2);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
-        for (int i = 0; i < w; i++)
-                for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
-}
\ No newline at end of file
+        size_t size = array2->size;
+        for (int i = 0; i < w; i++) {
+                /* walk the column's cells a stride at a time */
+                char *elem = array2->cells + (size_t) i * size;
+                for (int j = 0; j < h; j++, elem += array2->stride)
+                        apply(i, j, array2, elem, cl);
+        }
+}
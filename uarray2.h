@@ -8,7 +8,8 @@
 *      HW 3
 * 
 * 
-*      Summary: Solution code for uarray2.h. Interface for uarray2.c
+*      Summary: Solution code for uarray2.h. Interface for uarray2.c,
+*               a 2d unboxed array held row by row in one allocation
 *     
 **************************************************************************/
 
@@ -26,6 +27,8 @@ extern int   UArray2_width (T array2);
 extern int   UArray2_height(T array2);
 extern int   UArray2_size  (T array2);
 extern void *UArray2_at    (T array2, int i, int j);
+/* the cells of row j, contiguous from column 0 to width - 1 */
+extern void *UArray2_row   (T array2, int j);
 extern void  UArray2_map_row_major(T array2, UArray2_applyfun apply, void *cl);
 extern void  UArray2_map_col_major(T array2, UArray2_applyfun apply, void *cl);
 #undef T
@@ -1,9 +1,6 @@
-#line 59 "www/solutions/uarray2b.nw"
-#include <math.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
-#include "uarray2.h"
+#include "aligned.h"
 #include "uarray2b.h"
 
 #define T UArray2b_T
@@ -12,25 +9,35 @@ struct T { /* represents a 2D array of cells each of size 'size' */
         int width, height;
         unsigned blocksize;
         unsigned size;
-        UArray2_T blocks;
         /*
-         * matrix of blocks, each blocksize * blocksize 
-         *
-         * matrix dimensions are width and height divided by blocksize,
-         * rounded up
-         *
-         * a block is a Uarray_T of length blocksize * blocksize 
-         * and size 'size'
+         * when blocksize is a power of two, its log2 and blocksize - 1,
+         * so UArray2b_at can shift and mask instead of divide;
+         * otherwise shift is -1
+         */
+        int shift;
+        unsigned mask;
+        /*
+         * dimensions of the matrix of blocks, each blocksize * blocksize:
+         * width and height divided by blocksize, rounded up
+         */
+        int blocks_wide, blocks_high;
+        size_t block_bytes;     /* blocksize * blocksize * size */
+        char *cells;
+        /*
+         * every block lives in one contiguous, aligned allocation,
+         * blocks in the order UArray2b_map visits them: block (bx, by)
+         * starts at cells + (bx * blocks_high + by) * block_bytes
          *
-         * invariant relating cells in blocks to cells in the abstraction
-         *  described in section on coordinate transformations below
+         * within a block, cell (i, j) of the abstraction is at index
+         * (i % blocksize) * blocksize + j % blocksize, as described in
+         * the section on coordinate transformations below
          */
 };
-#line 94 "www/solutions/uarray2b.nw"
-#include <stdio.h>  /* include so we can print diagnostics */
 
 T UArray2b_new(int width, int height, int size, int blocksize)
 {
+        assert(width >= 0 && height >= 0);
+        assert(size > 0);
         assert(blocksize > 0);
         T array;
         NEW(array);
@@ -38,108 +45,152 @@ T UArray2b_new(int width, int height, int size, int blocksize)
         array->height = height;
         array->size   = size;
         array->blocksize = blocksize;
-        array->blocks = UArray2_new((width  + blocksize - 1) / blocksize,
-                                    (height + blocksize - 1) / blocksize,
-                                    sizeof(UArray_T));
-        int xblocks = UArray2_width (array->blocks); 
-        int yblocks = UArray2_height(array->blocks);
-        for (int i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *block = UArray2_at(array->blocks, i, j);
-                        *block = UArray_new(blocksize * blocksize, size);
-                        
-#line 169 "www/solutions/uarray2b.nw"
-if (0) {
-        fprintf(stderr, "Allocated %p; put %p at %p\n",
-                (void *)*block, (void *)*(UArray_T*)UArray2_at(array->blocks, i, j),
-                UArray2_at(array->blocks, i, j));
-}
-#line 115 "www/solutions/uarray2b.nw"
-                                  }
+        array->shift = -1;
+        array->mask  = blocksize - 1;
+        if ((blocksize & (blocksize - 1)) == 0) {
+                array->shift = __builtin_ctz(blocksize);
         }
+        /* rounded up without forming width + blocksize, which can
+         * overflow an int */
+        array->blocks_wide = width  / blocksize + (width  % blocksize != 0);
+        array->blocks_high = height / blocksize + (height % blocksize != 0);
+
+        /* blocksize * blocksize fits a size_t; the products with the
+         * cell size and the number of blocks may not */
+        size_t len;
+        int overflow =
+                __builtin_mul_overflow((size_t) blocksize * blocksize,
+                                       (size_t) size, &array->block_bytes)
+                | __builtin_mul_overflow(array->block_bytes,
+                                         (size_t) array->blocks_wide, &len)
+                | __builtin_mul_overflow(len, (size_t) array->blocks_high,
+                                         &len);
+        assert(!overflow);
+        /* one allocation of every block, zeroed like a fresh UArray */
+        array->cells = Aligned_alloc(len);
         return array;
 }
-#line 124 "www/solutions/uarray2b.nw"
+
 void UArray2b_free(T *array2b)
 {
-        int i;
         assert(array2b && *array2b);
-        T array = *array2b;
-        int xblocks = UArray2_width (array->blocks);
-        int yblocks = UArray2_height(array->blocks);
-        assert(UArray2_size(array->blocks) == sizeof(UArray_T));
-        for (i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *p = UArray2_at(array->blocks, i, j);
-                        UArray_free(p);
-                }
-        }
-        UArray2_free(&(*array2b)->blocks);
+        Aligned_free((*array2b)->cells);
         FREE(*array2b);
 }
-#line 148 "www/solutions/uarray2b.nw"
 T UArray2b_new_64K_block(int width, int height, int size)
 {
-        int blocksize = (int) floor(sqrt((double) (64 * 1024)
-                                         / (double) size));
-        if (blocksize == 0) {
-                blocksize = 1;
+        /* a power of two, so UArray2b_at can shift and mask */
+        long blocksize = 1;
+        while (4 * blocksize * blocksize * size <= 64 * 1024) {
+                blocksize *= 2;
         }
         /*  assert as big as possible */
-        assert((blocksize + 1) * (blocksize + 1) * size > 64 * 1024);
+        assert(4 * blocksize * blocksize * size > 64 * 1024);
         if (size <= 64 * 1024) { /* but no bigger */
                 assert(blocksize * blocksize * size <= 64 * 1024); 
         }
         return UArray2b_new(width, height, size, blocksize);
 }
-#line 200 "www/solutions/uarray2b.nw"
+
 void *UArray2b_at(T array2b, int i, int j)
 {
+        assert(array2b);
         assert(i >= 0 && j >= 0);
         /* avoid unused cells */
         assert(i < array2b->width && j < array2b->height);
-        int b  = array2b->blocksize;
-        int bx = i / b;   /* block x coordinate */
-        int by = j / b;   /* block y coordinate */
-        UArray_T *blockp = UArray2_at(array2b->blocks, bx, by);
-        return UArray_at(*blockp, (i % b) * b + j % b);
+        unsigned bx, by;  /* block x and y coordinates */
+        size_t cell;      /* index of the cell within its block */
+        if (array2b->shift >= 0) {
+                int      s = array2b->shift;
+                unsigned m = array2b->mask;
+                bx   = (unsigned) i >> s;
+                by   = (unsigned) j >> s;
+                cell = ((size_t) (i & m) << s) | (j & m);
+        } else {
+                int b = array2b->blocksize;
+                bx   = i / b;
+                by   = j / b;
+                cell = (size_t) (i % b) * b + j % b;
+        }
+        size_t block = (size_t) bx * array2b->blocks_high + by;
+        return array2b->cells + block * array2b->block_bytes
+                              + cell * array2b->size;
 }
-#line 222 "www/solutions/uarray2b.nw"
+
 void UArray2b_map(T array2b, 
                   void apply(int col, int row, T array2b,
                              void *elem, void *cl),
                   void *cl)
 {
         assert(array2b);
-        int       h      = array2b->height;
-        int       w      = array2b->width;
-        int       b      = array2b->blocksize;
-        UArray2_T blocks = array2b->blocks;
-        int       bw     = UArray2_width(blocks);
-        int       bh     = UArray2_height(blocks);
+        int    h     = array2b->height;
+        int    w     = array2b->width;
+        int    b     = array2b->blocksize;
+        size_t size  = array2b->size;
+        /* blocks are stored in the order they are visited */
+        char  *block = array2b->cells;
 
-        for (int bx = 0; bx < bw; bx++) {
-                for (int by = 0; by < bh; by++) {
-                        UArray_T *blockp = UArray2_at(blocks, bx, by);
-                        UArray_T  block  = *blockp;
-                        int       len    = UArray_length(block);
-                        /* (i0, j0) correspond to upper left */
-                        /* corner of block (bx, by)          */
-                        int i0 = b * bx; 
-                        int j0 = b * by; 
-                        for (int cell = 0; cell < len; cell++) {
-                                int i = i0 + cell / b;
-                                int j = j0 + cell % b;
-                                /* measured overhead 0.5% to 1.5% */
-                                if (i < w && j < h) {
-                                        apply(i, j, array2b, 
-                                              UArray_at(block, cell), cl);
+        /* (i0, j0) is the upper left corner of block (bx, by); sums
+         * are kept below w and h, so they cannot overflow */
+        for (int bx = 0; bx < array2b->blocks_wide; bx++) {
+                int i0 = bx * b;
+                for (int by = 0; by < array2b->blocks_high; by++) {
+                        int j0 = by * b;
+                        char *elem = block;
+                        if (w - i0 >= b && h - j0 >= b) {
+                                /* interior block: every cell, in order */
+                                for (int i = i0; i < i0 + b; i++) {
+                                        for (int j = j0; j < j0 + b; j++) {
+                                                apply(i, j, array2b, elem,
+                                                      cl);
+                                                elem += size;
+                                        }
+                                }
+                        } else {
+                                /* edge block: only the cells inside the
+                                 * array, skipping the rest of each column
+                                 */
+                                int iend = w - i0 < b ? w : i0 + b;
+                                int jend = h - j0 < b ? h : j0 + b;
+                                for (int i = i0; i < iend; i++) {
+                                        elem = block + (size_t) (i - i0)
+                                                       * b * size;
+                                        for (int j = j0; j < jend; j++) {
+                                                apply(i, j, array2b, elem,
+                                                      cl);
+                                                elem += size;
+                                        }
                                 }
                         }
+                        block += array2b->block_bytes;
+                }
+        }
+}
+
+void UArray2b_map_blocks(T array2b,
+                         void apply(int col, int row, int width, int height,
+                                    T array2b, void *cells, void *cl),
+                         void *cl)
+{
+        assert(array2b);
+        int   h     = array2b->height;
+        int   w     = array2b->width;
+        int   b     = array2b->blocksize;
+        char *block = array2b->cells;
+
+        for (int bx = 0; bx < array2b->blocks_wide; bx++) {
+                /* the last column and row of blocks may be cut short */
+                int i0 = bx * b;
+                int bw = w - i0 < b ? w - i0 : b;
+                for (int by = 0; by < array2b->blocks_high; by++) {
+                        int j0 = by * b;
+                        int bh = h - j0 < b ? h - j0 : b;
+                        apply(i0, j0, bw, bh, array2b, block, cl);
+                        block += array2b->block_bytes;
                 }
         }
 }
-#line 269 "www/solutions/uarray2b.nw"
+
 int UArray2b_height(T array2b)
 {
         assert(array2b);
@@ -162,5 +213,3 @@ int UArray2b_blocksize(T array2b)
         assert(array2b);
         return array2b->blocksize;
 }
-#line 296 "www/solutions/uarray2b.nw"
-int UArray2b_version_uses_UArray2_T = 1;
\ No newline at end of file
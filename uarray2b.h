@@ -11,7 +11,7 @@ typedef struct T *T;
  */
 extern T    UArray2b_new (int width, int height, int size, int blocksize);
 
-/* new blocked 2d array: blocksize as large as possible provided
+/* new blocked 2d array: blocksize the largest power of two provided
  * block occupies at most 64KB (if possible)
  */
 extern T    UArray2b_new_64K_block(int width, int height, int size);
@@ -34,6 +34,18 @@ extern void  UArray2b_map(T array2b,
                                      void *elem, void *cl), 
                           void *cl);
 
+/* calls apply once per block, in the order of UArray2b_map, with the
+ * column and row of its upper left cell, the width and height of the
+ * part of it inside the array, and its cells, which are contiguous:
+ * cell (col + x, row + y) is at cells + (x * blocksize + y) * size
+ */
+extern void  UArray2b_map_blocks(T array2b,
+                                 void apply(int col, int row,
+                                            int width, int height,
+                                            T array2b, void *cells,
+                                            void *cl),
+                                 void *cl);
+
 /* 
  * it is a checked run-time error to pass a NULL T
  * to any function in this interface 
@@ -15,150 +15,122 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "assert.h"
 #include "wordpack.h"
-#include "RGBCVconvert.h"
-#include "bitpack.h"
-#include "arith40.h"
+#include "layout.h"
+#include "tempmap.h"
+#include "simd.h"
+#include "dispatch.h"
 
-/*
-static const int A_COEFF = 511;
-static const int BCD_COEFF = 50;
-
-static const unsigned A_WIDTH = 9;
-static const unsigned BCD_WIDTH = 5;
-static const unsigned PB_WIDTH = 4;
-static const unsigned PR_WIDTH = 4;
-
-static const unsigned A_LSB = 23;
-static const unsigned B_LSB = 18;
-static const unsigned C_LSB = 13;
-static const unsigned D_LSB = 8;
-static const unsigned PB_LSB = 4;
-static const unsigned PR_LSB = 0;
-*/
-
-/* challenge values */
-/* Max value of bits with width of */
-/* 6 is (2^6) - 1 = 63 */
-static const int A_COEFF = 63;
-static const int BCD_COEFF = 50;
-
-static const unsigned A_WIDTH = 6;
-static const unsigned BCD_WIDTH = 6;
-static const unsigned PB_WIDTH = 4;
-static const unsigned PR_WIDTH = 4;
-
-static const unsigned A_LSB = 26;
-static const unsigned B_LSB = 20;
-static const unsigned C_LSB = 14;
-static const unsigned D_LSB = 8;
-static const unsigned PB_LSB = 4;
-static const unsigned PR_LSB = 0;
+/* number of codewords print_compressed writes with one fwrite */
+#define OUTPUT_WORDS 16384
+
+/* a 32bit codeword with its bytes in the big-endian order of the
+ * compressed file; byte swapping is its own inverse */
+static inline uint32_t big_endian(uint32_t word)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap32(word);
+#else
+    return word;
+#endif
+}
+
+/* byte swap kernels, one per tier; each swaps whole vectors of
+ * codewords from the start and returns how many it swapped */
+typedef size_t swap_kernel(const unsigned char bytes[], size_t count,
+                           uint32_t words[]);
 
+#ifdef HAVE_X86_SIMD
+static swap_kernel swap_sse2, swap_avx2, swap_avx512;
+
+static swap_kernel *const swap_kernels[TIER_COUNT] = {
+    NULL, swap_sse2, swap_avx2, swap_avx512
+};
+#else
+static swap_kernel *const swap_kernels[TIER_COUNT] = { NULL };
+#endif
 
 /****************************************************************
  * print_compressed
  * Description: Print out coded words in big-endian
- * Inputs: 1) Unboxed array containg coded words
- *         2) PPM image
+ * Inputs: 1) Array of 32bit coded words
+ *         2) Number of words
+ *         3) Width of the image
+ *         4) Height of the image
+ *         5) Layout the words are packed with
+ *         6) Whether the words are stored row by row
  * Output: Void
- * Implementation: For each 32-bit packed word, print out from
- *                 most significant byte by using putchar.
+ * Implementation: Print the header, then the words.
  *****************************************************************/
-void print_compressed(UArray_T words, Pnm_ppm image)
+void print_compressed(const uint32_t words[], size_t count,
+                      unsigned width, unsigned height, Layout_T layout,
+                      bool row_major)
 {
-    unsigned width = image->width;
-    unsigned height = image->height;
-
-    printf("COMP40 Compressed image format 2\n%u %u", width, height);
-    printf("\n");
-        
-    for (int i = 0; i < UArray_length(words); i++)
-    {
-        uint64_t word = *(uint64_t *) UArray_at(words, i);
-        /* Print in big-endian by looping through 32bit word
-         * from index 24 and decrementing by 8 */
-        for (int j = 24; j >= 0; j -= 8)
-        {
-            putchar(Bitpack_getu(word, 8, j));
-        }
-    }
+    print_header(width, height, layout, row_major);
+    print_words(words, count);
 }
 
 /****************************************************************
- * wordpack
- * Description: Pack coefficient values into 32bit word.
- * Inputs: 1) Struct holding coeffcient values
- * Output: Unsigned type of packed word
- * Implementation: Perform bitpack new operation to assign values
- *                 given width and least significant bit values
- *                 for each coefficient values.
+ * print_header
+ * Description: Print out the header of a compressed image
+ * Inputs: 1) Width of the image
+ *         2) Height of the image
+ *         3) Layout the words are packed with
+ *         4) Whether the words are stored row by row
+ * Output: Void
+ * Implementation: Codewords of the default layout, stored column
+ *                 by column, get the usual format 2 header. Any
+ *                 others get a format 3 header, which names the
+ *                 layout, and the order if it is row by row, on a
+ *                 line of its own after the dimensions.
  *****************************************************************/
-uint64_t wordpack(coeff cf)
+void print_header(unsigned width, unsigned height, Layout_T layout,
+                  bool row_major)
 {
-    uint64_t packword = 0;
-    
-    packword = Bitpack_newu(packword, A_WIDTH, A_LSB, cf.a);
-    packword = Bitpack_news(packword, BCD_WIDTH, B_LSB, cf.b);
-    packword = Bitpack_news(packword, BCD_WIDTH, C_LSB, cf.c);
-    packword = Bitpack_news(packword, BCD_WIDTH, D_LSB, cf.d);
-    packword = Bitpack_newu(packword, PB_WIDTH, PB_LSB, cf.pb);
-    packword = Bitpack_newu(packword, PR_WIDTH, PR_LSB, cf.pr);
-
-    return packword;
+    if (layout == Layout_default() && !row_major)
+    {
+        printf("COMP40 Compressed image format 2\n%u %u", width, height);
+        printf("\n");
+    }
+    else
+    {
+        printf("COMP40 Compressed image format 3\n%u %u", width, height);
+        printf("\nlayout=%s%s\n", layout->name,
+               row_major ? " order=row" : "");
+    }
 }
 
 /****************************************************************
- * dct
- * Description: Perform discrete cosine transformation.
- * Inputs: 1) Unboxed array of block 2D array with component
- *            video values
- * Output: Computed coefficient values
- * Implementation: Get component video values from the block
- *                 and perform discrete cosine transformation
- *                 to a,b,c,d coefficient values and perform
- *                 quantization for pb and pr coefficient values.
+ * print_words
+ * Description: Print out coded words in big-endian
+ * Inputs: 1) 32bit coded words
+ *         2) Number of words
+ * Output: Void
+ * Implementation: Swap the words to big-endian a buffer at a time
+ *                 with swap_compressed and write each buffer with
+ *                 a single fwrite.
  *****************************************************************/
-coeff dct(UArray_T block)
+void print_words(const uint32_t words[], size_t count)
 {
-    /* get y from component video block */
-    float y1 = ((CV *) UArray_at(block, 0))->y;
-    float y2 = ((CV *) UArray_at(block, 1))->y;
-    float y3 = ((CV *) UArray_at(block, 2))->y;
-    float y4 = ((CV *) UArray_at(block, 3))->y;
-
-    float a = (y4 + y3 + y2 + y1) / 4.0;
-    float b = bcd_check((y4 + y3 - y2 - y1) / 4.0);
-    float c = bcd_check((y4 - y3 + y2 - y1) / 4.0);
-    float d = bcd_check((y4 - y3 - y2 + y1) / 4.0);
-
-    unsigned cfa = (unsigned) round(a * A_COEFF);
-    signed cfb= (signed) round(b * BCD_COEFF);
-    signed cfc = (signed) round(c * BCD_COEFF);
-    signed cfd = (signed) round(d * BCD_COEFF);
-
-    float pb = 0.0;
-    float pr = 0.0;
-
-    /* sum pb, pr values of each elements of the block */
-    for (int i = 0; i < UArray_length(block); i++)
-    {
-        pb += ((CV *) UArray_at(block, i))->pb;
-        pr += ((CV *) UArray_at(block, i))->pr;
-    }
-
-    float avgpb = pb / (float) UArray_length(block);
-    float avgpr = pr / (float) UArray_length(block);
-
-    unsigned cfpb = Arith40_index_of_chroma(avgpb);
-    unsigned cfpr = Arith40_index_of_chroma(avgpr);
+    uint32_t buffer[OUTPUT_WORDS];
 
-    /* store coefficient values to struct */
-    coeff cf = { cfa, cfb, cfc, cfd, cfpb, cfpr };
+    for (size_t first = 0; first < count; first += OUTPUT_WORDS)
+    {
+        size_t n = count - first;
+        if (n > OUTPUT_WORDS)
+        {
+            n = OUTPUT_WORDS;
+        }
 
-    return cf;
+        swap_compressed((const unsigned char *) &words[first], n, buffer);
+        size_t written = fwrite(buffer, sizeof(uint32_t), n, stdout);
+        assert(written == n);
+    }
 }
 
 /****************************************************************
@@ -189,107 +161,193 @@ float bcd_check(float coeff)
 /****************************************************************
  * read_compressed
  * Description: Read compressed file and put them into array
- * Inputs: 1) File pointer
- *         2) PPM pixmap
- *         3) blocksize used for 2D array
- * Output: Unboxed array of coded words
- * Implementation: Allocate array for packed word that will be
- *                 inserted when the 32bit word is read in
- *                 big-endian way from the file.
+ * Inputs: 1) File pointer, at the first codeword
+ *         2) Number of codewords in the file
+ * Output: Array of 32bit coded words, from Tempmap_alloc
+ * Implementation: Allocate array for packed word and read all of
+ *                 the words into it with read_words. The array is
+ *                 a temporary file out of core.
+ *****************************************************************/
+uint32_t *read_compressed(FILE *fp, size_t count)
+{
+    uint32_t *words = Tempmap_alloc(count * sizeof(uint32_t));
+
+    read_words(fp, words, count);
+
+    return words;
+}
+
+/****************************************************************
+ * read_words
+ * Description: Read coded words from a compressed file
+ * Inputs: 1) File pointer, at the first word to read
+ *         2) Array the words are stored in
+ *         3) Number of words
+ * Output: Void
+ * Implementation: Read all of the words with a single fread, then
+ *                 swap them from big-endian in place. A file too
+ *                 short for the words is a checked runtime error.
  *****************************************************************/
-UArray_T read_compressed(FILE *fp, Pnm_ppm pixmap, int blocksize)
+void read_words(FILE *fp, uint32_t words[], size_t count)
 {
-    unsigned width = pixmap->width;
-    unsigned height = pixmap->height;
+    size_t got = fread(words, sizeof(uint32_t), count, fp);
+    assert(got == count);
+    swap_compressed((const unsigned char *) words, count, words);
+}
 
-    int word_len = (width * height) / (blocksize * blocksize);
+/****************************************************************
+ * map_compressed
+ * Description: Map the codewords of a compressed file into memory
+ * Inputs: 1) File pointer, at the first codeword
+ *         2) Number of codewords in the file
+ * Output: Bytes of the codewords, as they are in the file, or NULL
+ *         if the file is not a regular file or cannot be mapped
+ * Implementation: Map the file read-only from the page that holds
+ *                 the first codeword, so the pages are shared with
+ *                 the page cache and nothing is read until it is
+ *                 used. A file too short for its codewords is a
+ *                 checked runtime error.
+ *****************************************************************/
+const unsigned char *map_compressed(FILE *fp, size_t count)
+{
+    int fd = fileno(fp);
+    off_t offset = ftell(fp);
+    struct stat st;
 
-    UArray_T words = UArray_new(word_len, sizeof(uint64_t));
-    assert(words != NULL);
+    if (fd < 0 || offset < 0 || fstat(fd, &st) != 0 ||
+        !S_ISREG(st.st_mode))
+    {
+        return NULL;
+    }
+    assert(st.st_size - offset >= (off_t) count * 4);
 
-    for (int i = 0; i < word_len; i++)
+    off_t page = offset - offset % sysconf(_SC_PAGESIZE);
+    size_t len = (size_t) (offset - page) + count * 4;
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, page);
+    if (map == MAP_FAILED)
     {
-        uint64_t word = 0;
-        /* Get codewords in big-endian by looping through 32bit word
-         * from index 24 and decrementing by 8 */
-        for (int j = 24; j >= 0; j -= 8)
-        {
-            word = Bitpack_newu(word, 8, j, (uint64_t) fgetc(fp));
-        }
-        *(uint64_t *) UArray_at(words, i) = word;
+        return NULL;
     }
 
-    return words;
+    return (const unsigned char *) map + (offset - page);
 }
 
 /****************************************************************
- * unpack
- * Description: Unpack word to extract coefficient values.
- * Inputs: 1) Unsigned packed word
- * Output: Struct of coefficient values
- * Implementation: Extract coefficient values using Bitpack_get
- *                 operations.
+ * unmap_compressed
+ * Description: Unmap codewords mapped with map_compressed
+ * Inputs: 1) Bytes of the codewords
+ *         2) Number of codewords
+ * Output: Void
+ * Implementation: The mapping starts at the page the bytes start
+ *                 in, so its start and length follow from them.
  *****************************************************************/
-coeff unpack(uint64_t packword)
+void unmap_compressed(const unsigned char *bytes, size_t count)
 {
-    unsigned pr = Bitpack_getu(packword, PR_WIDTH, PR_LSB);
-    unsigned pb = Bitpack_getu(packword, PB_WIDTH, PB_LSB);
-    signed d = Bitpack_gets(packword, BCD_WIDTH, D_LSB);
-    signed c = Bitpack_gets(packword, BCD_WIDTH, C_LSB);
-    signed b = Bitpack_gets(packword, BCD_WIDTH, B_LSB);
-    signed a = Bitpack_getu(packword, A_WIDTH, A_LSB);
+    uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) bytes - (uintptr_t) bytes % page_size;
+    size_t len = ((uintptr_t) bytes - start) + count * 4;
 
-    coeff cf = { a, b, c, d, pb, pr };
-
-    return cf;
+    munmap((void *) start, len);
 }
 
 /****************************************************************
- * inverse_dct
- * Description: Perform inverse discrete cosine transformation to
- *              store component video values in each block.
- * Inputs: 1) Struct holding coefficient values
- *         2) Blocksize used for 2D array
- * Output: Unboxed array of component video values for each block
- * Implementation: Convert chroma-coded pb and pr into pb and pr.
- *                 Perform inverse dct operation listed from spec
- *                 on coefficient values to get component video
- *                 values that is stored in newly allocated block
- *                 array.
+ * swap_compressed
+ * Description: Convert codewords as they are in a compressed file
+ *              to 32bit words
+ * Inputs: 1) Bytes of the codewords, big-endian and not
+ *            necessarily aligned
+ *         2) Number of codewords
+ *         3) Array the words are stored in, which may be the
+ *            bytes themselves
+ * Output: Void
+ * Implementation: Swap 16, 8 or 4 words at a time with the
+ *                 AVX-512, AVX2 or SSE2 kernel of the tier in use.
+ *                 Load each remaining word with memcpy, which
+ *                 compiles to a plain unaligned load, and swap it
+ *                 with bswap.
  *****************************************************************/
-UArray_T inverse_dct(coeff cf, int blocksize)
+void swap_compressed(const unsigned char bytes[], size_t count,
+                     uint32_t words[])
+{
+    size_t done = 0;
+    swap_kernel *kernel = swap_kernels[Dispatch_tier_in_use()];
+
+    if (kernel != NULL)
+    {
+        done = kernel(bytes, count, words);
+    }
+
+    for (size_t i = done; i < count; i++)
+    {
+        uint32_t word;
+        memcpy(&word, &bytes[4 * i], sizeof(word));
+        words[i] = big_endian(word);
+    }
+}
+
+#ifdef HAVE_X86_SIMD
+
+/*
+ * SIMD byte swap kernels. x86 is little-endian, so every word is
+ * swapped. Each vector is loaded before it is stored, so the words
+ * may be swapped in place.
+ */
+
+/* SSE2 has no byte shuffle: swap the bytes of each 16-bit half with
+ * shifts, then swap the halves */
+static size_t swap_sse2(const unsigned char bytes[], size_t count,
+                        uint32_t words[])
 {
-    UArray_T block = UArray_new(blocksize * blocksize,
-                                sizeof(CV));
-    assert(block != NULL);
+    size_t i;
 
-    float pb = Arith40_chroma_of_index(cf.pb);
-    float pr = Arith40_chroma_of_index(cf.pr);
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) &bytes[4 * i]);
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *) &words[i], x);
+    }
 
-    /* assign pb,pr for each elements of the block */
-    for (int i = 0; i < UArray_length(block); i++)
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t swap_avx2(const unsigned char bytes[], size_t count,
+                        uint32_t words[])
+{
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                           11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4,
+                                           11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i;
+
+    for (i = 0; i + 8 <= count; i += 8)
     {
-        ((CV *) UArray_at(block, i))->pb = pb;
-        ((CV *) UArray_at(block, i))->pr = pr;
+        __m256i x = _mm256_loadu_si256((const __m256i *) &bytes[4 * i]);
+        _mm256_storeu_si256((__m256i *) &words[i],
+                            _mm256_shuffle_epi8(x, order));
     }
 
-    float a = (float) cf.a / (float) A_COEFF;
-    float b = (float) cf.b / (float) BCD_COEFF;
-    float c = (float) cf.c / (float) BCD_COEFF;
-    float d = (float) cf.d / (float) BCD_COEFF;
+    return i + swap_sse2(&bytes[4 * i], count - i, &words[i]);
+}
 
-    float y1 = a - b - c + d;
-    float y2 = a - b + c - d;
-    float y3 = a + b - c - d;
-    float y4 = a + b + c + d;
+__attribute__((target(AVX512)))
+static size_t swap_avx512(const unsigned char bytes[], size_t count,
+                          uint32_t words[])
+{
+    const __m512i order = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                      11, 10, 9, 8, 15, 14, 13, 12));
+    size_t i;
 
-    /* assign y component video values to each
-     * element of the block */
-    ((CV *) UArray_at(block, 0))->y = y1;
-    ((CV *) UArray_at(block, 1))->y = y2;
-    ((CV *) UArray_at(block, 2))->y = y3;
-    ((CV *) UArray_at(block, 3))->y = y4;
+    for (i = 0; i + 16 <= count; i += 16)
+    {
+        __m512i x = _mm512_loadu_si512(&bytes[4 * i]);
+        _mm512_storeu_si512(&words[i], _mm512_shuffle_epi8(x, order));
+    }
 
-    return block;
+    return i + swap_avx2(&bytes[4 * i], count - i, &words[i]);
 }
 
+#endif
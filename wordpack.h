@@ -17,8 +17,10 @@
 #define WORDPACK_INCLUDED
 
 #include <stdint.h>
-#include "uarray.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include "pnm.h"
+#include "RGBCVconvert.h"
 
 /* struct holding info of cosine coefficients */
 typedef struct
@@ -31,21 +33,36 @@ typedef struct
     unsigned pr;
 } coeff;
 
-/* print compressed codewords */
-void print_compressed(UArray_T words, Pnm_ppm image);
-/* pack coeff values into codeword using bitpack */
-uint64_t wordpack(coeff cf);
-/* perform discrete cosine transform to obtain coeff values */
-coeff dct(UArray_T block);
+/* codeword layout, from layout.h; packing, transforming and their
+ * inverses are functions of the layout */
+struct Layout_T;
+
+/* print an array of 32bit compressed codewords, with a header
+ * naming their layout and block order unless they are the default
+ * ones */
+void print_compressed(const uint32_t words[], size_t count,
+                      unsigned width, unsigned height,
+                      const struct Layout_T *layout, bool row_major);
+/* the two halves of print_compressed, for words printed a few at
+ * a time */
+void print_header(unsigned width, unsigned height,
+                  const struct Layout_T *layout, bool row_major);
+void print_words(const uint32_t words[], size_t count);
 /* check if b, c, d values are between -0.3 and 0.3 */
 float bcd_check(float coeff);
 
-/* read compressed codewords */
-UArray_T read_compressed(FILE *fp, Pnm_ppm pixmap, int blocksize);
-/* unpack codewords into coeff values using bitpack */
-coeff unpack(uint64_t packword);
-/* perform inverse discrete cosine transform to obtain 
- * array of blocks with component video values */
-UArray_T inverse_dct(coeff cf, int blocksize);
+/* read compressed codewords into an array of 32bit words from
+ * Tempmap_alloc, freed with Tempmap_free */
+uint32_t *read_compressed(FILE *fp, size_t count);
+/* read the next count codewords into words */
+void read_words(FILE *fp, uint32_t words[], size_t count);
+/* map the count codewords of a regular file, from its position on,
+ * into memory as they are in the file; NULL if it cannot be mapped */
+const unsigned char *map_compressed(FILE *fp, size_t count);
+void unmap_compressed(const unsigned char *bytes, size_t count);
+/* convert count big-endian codewords as they are in a file into
+ * 32bit words, which may overwrite the bytes */
+void swap_compressed(const unsigned char bytes[], size_t count,
+                     uint32_t words[]);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+/*************************************************************************
+*                          wordpack_common.c
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Implementation file for the parts of the packing and
+*               transform code that are the same for every codeword
+*               layout: the tables of the fixed-point path and the
+*               helpers the batch kernels of wordpack_layout.inc
+*               store their lanes with.
+*     
+**************************************************************************/
+
+#include <math.h>
+#include <pthread.h>
+#include "assert.h"
+#include "bitpack_unchecked.h"
+#include "RGBCVconvert.h"
+#include "wordpack_common.h"
+
+static fixed_tables tables;
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void fill_tables(void);
+
+/****************************************************************
+ * get_fixed_tables
+ * Description: Get the tables of the fixed-point path
+ * Inputs: None
+ * Output: Pointer to the tables
+ * Implementation: Fill them in on the first call, once for every
+ *                 thread.
+ *****************************************************************/
+const fixed_tables *get_fixed_tables(void)
+{
+    pthread_once(&tables_once, fill_tables);
+    return &tables;
+}
+
+/****************************************************************
+ * fill_tables
+ * Description: Fill in the tables of the fixed-point path
+ * Inputs: None
+ * Output: Void
+ * Implementation: Scale the rows of the conversion matrices,
+ *                 rounding to nearest, and work out the chroma
+ *                 part of each channel for every pair of chroma
+ *                 indices.
+ *****************************************************************/
+static void fill_tables(void)
+{
+    double rgb_scale = (double) (1 << RGB_FIXED_BITS) / 255;
+    double cv_scale = 255.0 * (1 << CV_FIXED_BITS);
+
+    for (int i = 0; i < 3; i++)
+    {
+        tables.y[i] = lround(RGB_TO_Y[i] * rgb_scale);
+        tables.pb[i] = lround(RGB_TO_PB[i] * rgb_scale);
+        tables.pr[i] = lround(RGB_TO_PR[i] * rgb_scale);
+    }
+
+    for (unsigned pb = 0; pb < CHROMA_LEVELS; pb++)
+    {
+        for (unsigned pr = 0; pr < CHROMA_LEVELS; pr++)
+        {
+            double cpb = Chroma_of_index(pb);
+            double cpr = Chroma_of_index(pr);
+            unsigned index = pb * CHROMA_LEVELS + pr;
+
+            tables.red[index] = lround((CV_TO_R[1] * cpb + CV_TO_R[2] * cpr)
+                                       * cv_scale);
+            tables.green[index] = lround((CV_TO_G[1] * cpb
+                                          + CV_TO_G[2] * cpr) * cv_scale);
+            tables.blue[index] = lround((CV_TO_B[1] * cpb + CV_TO_B[2] * cpr)
+                                        * cv_scale);
+        }
+    }
+}
+
+/****************************************************************
+ * load_chroma_fixed
+ * Description: Look up the chroma part of each channel for a
+ *              vector of codewords
+ * Inputs: 1) Number of codewords
+ *         2) Codewords
+ *         3) Arrays the red, green and blue parts are stored in
+ * Output: Void
+ * Implementation: Index the tables with the low byte of each
+ *                 codeword, which holds its pb and pr indices.
+ *                 The tables must have been got already.
+ *****************************************************************/
+void load_chroma_fixed(int lanes, const uint32_t words[], int32_t red[],
+                       int32_t green[], int32_t blue[])
+{
+    for (int l = 0; l < lanes; l++)
+    {
+        unsigned chroma = Bitpack_getu_unchecked(words[l], 8, 0);
+        red[l] = tables.red[chroma];
+        green[l] = tables.green[chroma];
+        blue[l] = tables.blue[chroma];
+    }
+}
+
+/****************************************************************
+ * store_coeffs
+ * Description: Store the quantized lanes of a kernel into
+ *              coefficient structs
+ * Inputs: 1) Number of lanes
+ *         2) Quantized a, b, c, d, pb and pr of each lane
+ *         3) Array the structs are stored in, one per lane
+ * Output: Void
+ *****************************************************************/
+void store_coeffs(int lanes, const int32_t qa[], const int32_t qb[],
+                  const int32_t qc[], const int32_t qd[],
+                  const int32_t qpb[], const int32_t qpr[], coeff cf[])
+{
+    for (int l = 0; l < lanes; l++)
+    {
+        cf[l] = (coeff) { qa[l], qb[l], qc[l], qd[l], qpb[l], qpr[l] };
+    }
+}
+
+/****************************************************************
+ * store_rgb
+ * Description: Store one cell of a vector of decoded blocks
+ * Inputs: 1) Number of lanes, one block each
+ *         2) Cell of the blocks, 0 and 2 being in the top row
+ *         3) Bytes of the cell, grouped as 4 red, 4 green, 4 blue
+ *            and 4 unused bytes per 4 lanes
+ *         4) Array the top row of pixels of the blocks is in
+ *         5) Array the bottom row is in
+ * Output: Void
+ *****************************************************************/
+void store_rgb(int lanes, int cell, const unsigned char bytes[],
+               unsigned char top[], unsigned char bottom[])
+{
+    for (int l = 0; l < lanes; l++)
+    {
+        const unsigned char *group = &bytes[16 * (l / 4) + l % 4];
+        unsigned char *rgb = (cell % 2 == 0 ? top : bottom)
+                             + 6 * l + 3 * (cell / 2);
+        rgb[0] = group[0];
+        rgb[1] = group[4];
+        rgb[2] = group[8];
+    }
+}
@@ -0,0 +1,230 @@
+/*************************************************************************
+*                          wordpack_common.h
+* 
+* 
+*      Authors: Jae Hyun Cheigh (jcheig01), Suyu Lui (sliu21)
+*
+*      Fall 2020 - COMP40
+*      HW 4
+* 
+* 
+*      Summary: Header file for wordpack_common.c, with the tables
+*               and helpers of wordpack_layout.inc that do not depend
+*               on the codeword layout, so that they are built once
+*               rather than once per layout. The vector helpers are
+*               inline, like those of simd.h, so the kernels of every
+*               layout keep them in registers.
+*     
+**************************************************************************/
+
+#ifndef WORDPACK_COMMON_INCLUDED
+#define WORDPACK_COMMON_INCLUDED
+
+#include <stdint.h>
+#include "wordpack.h"
+#include "chroma.h"
+#include "simd.h"
+
+/*
+ * Fixed-point path for 8-bit images. Component values are scaled by
+ * 2^RGB_FIXED_BITS, so a block's sum of four of them is its mean
+ * scaled by 2^SUM_FIXED_BITS. Decoded values are 8-bit levels scaled
+ * by 2^CV_FIXED_BITS. All coefficients fit in 16 bits, so the kernels
+ * multiply with pmaddwd and every sum fits in 32 bits.
+ */
+#define RGB_FIXED_BITS 20
+#define SUM_FIXED_BITS (RGB_FIXED_BITS + 2)
+#define CV_FIXED_BITS 12
+
+/* tables of the fixed-point path that every layout shares */
+typedef struct
+{
+    /* rows of the RGB to component video matrices, per 8-bit level */
+    int32_t y[3], pb[3], pr[3];
+    /* chroma part of each channel, by the pb and pr indices of a
+     * codeword, pb * CHROMA_LEVELS + pr, which is the low byte of a
+     * codeword in every layout */
+    int32_t red[CHROMA_LEVELS * CHROMA_LEVELS];
+    int32_t green[CHROMA_LEVELS * CHROMA_LEVELS];
+    int32_t blue[CHROMA_LEVELS * CHROMA_LEVELS];
+} fixed_tables;
+
+/* the fixed-point tables, filled in on the first call */
+const fixed_tables *get_fixed_tables(void);
+
+/* look up the chroma part of each channel for each of lanes words */
+void load_chroma_fixed(int lanes, const uint32_t words[], int32_t red[],
+                       int32_t green[], int32_t blue[]);
+
+/* store quantized lanes into coefficient structs */
+void store_coeffs(int lanes, const int32_t qa[], const int32_t qb[],
+                  const int32_t qc[], const int32_t qd[],
+                  const int32_t qpb[], const int32_t qpr[], coeff cf[]);
+
+/* interleave the red, green and blue bytes a kernel gives for cell
+ * cell of lanes blocks into the two rows of pixels of the blocks */
+void store_rgb(int lanes, int cell, const unsigned char bytes[],
+               unsigned char top[], unsigned char bottom[]);
+
+/* chroma index of the mean of four scaled pb or pr values */
+static inline unsigned chroma_index_fixed(int32_t sum)
+{
+    return Chroma_index_of((float) sum / (1 << SUM_FIXED_BITS));
+}
+
+/* clamp a scaled level to 0..255, dropping its fraction */
+static inline unsigned char level_fixed(int32_t value)
+{
+    if (value < 0)
+    {
+        return 0;
+    }
+    value >>= CV_FIXED_BITS;
+    return value > 255 ? 255 : value;
+}
+
+/* two 16-bit coefficients side by side in a 32-bit lane */
+static inline int32_t pair_fixed(int32_t lo, int32_t hi)
+{
+    return (int32_t) ((uint16_t) lo | (uint32_t) (uint16_t) hi << 16);
+}
+
+#ifdef HAVE_X86_SIMD
+
+/* bcd_check of every lane, as a float min and max */
+static inline __m128 bcd_sse2(__m128 coeff)
+{
+    return _mm_min_ps(_mm_max_ps(coeff, _mm_set1_ps(-0.3f)),
+                      _mm_set1_ps(0.3f));
+}
+
+/* Chroma_index_of of every lane, counting the thresholds at or
+ * below it; comparison masks are -1 where true */
+static inline __m128i chroma_index_sse2(__m128 value)
+{
+    __m128i index = _mm_setzero_si128();
+    for (int j = 0; j < CHROMA_LEVELS - 1; j++)
+    {
+        __m128 above = _mm_cmpge_ps(value, _mm_set1_ps(CHROMA_THRESHOLDS[j]));
+        index = _mm_sub_epi32(index, _mm_castps_si128(above));
+    }
+    return index;
+}
+
+/* mean of four scaled pb or pr values, as in chroma_index_fixed;
+ * the sums are exact in float and the scaling is a power of two */
+static inline __m128 mean_fixed_sse2(__m128i sum)
+{
+    return _mm_mul_ps(_mm_cvtepi32_ps(sum),
+                      _mm_set1_ps(1.0f / (1 << SUM_FIXED_BITS)));
+}
+
+/* a field of each lane's 32bit codeword, cut out by shifting it to
+ * the top of the lane and back down, arithmetically if is_signed */
+static inline __m128i field_sse2(__m128i words, unsigned width,
+                                 unsigned lsb, int is_signed)
+{
+    __m128i top = _mm_slli_epi32(words, 32 - width - lsb);
+    return is_signed ? _mm_srai_epi32(top, 32 - width)
+                     : _mm_srli_epi32(top, 32 - width);
+}
+
+/* Chroma_of_index of every lane */
+static inline __m128 chroma_of_index_sse2(__m128i index)
+{
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i *) lanes, index);
+    return _mm_setr_ps(CHROMA_OF_INDEX[lanes[0]], CHROMA_OF_INDEX[lanes[1]],
+                       CHROMA_OF_INDEX[lanes[2]], CHROMA_OF_INDEX[lanes[3]]);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 bcd_avx2(__m256 coeff)
+{
+    return _mm256_min_ps(_mm256_max_ps(coeff, _mm256_set1_ps(-0.3f)),
+                         _mm256_set1_ps(0.3f));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i chroma_index_avx2(__m256 value)
+{
+    __m256i index = _mm256_setzero_si256();
+    for (int j = 0; j < CHROMA_LEVELS - 1; j++)
+    {
+        __m256 above = _mm256_cmp_ps(value,
+                                     _mm256_set1_ps(CHROMA_THRESHOLDS[j]),
+                                     _CMP_GE_OQ);
+        index = _mm256_sub_epi32(index, _mm256_castps_si256(above));
+    }
+    return index;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 mean_fixed_avx2(__m256i sum)
+{
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(sum),
+                         _mm256_set1_ps(1.0f / (1 << SUM_FIXED_BITS)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i field_avx2(__m256i words, unsigned width,
+                                 unsigned lsb, int is_signed)
+{
+    __m256i top = _mm256_slli_epi32(words, 32 - width - lsb);
+    return is_signed ? _mm256_srai_epi32(top, 32 - width)
+                     : _mm256_srli_epi32(top, 32 - width);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 chroma_of_index_avx2(__m256i index)
+{
+    return _mm256_i32gather_ps(CHROMA_OF_INDEX, index, sizeof(float));
+}
+
+__attribute__((target(AVX512)))
+static inline __m512 bcd_avx512(__m512 coeff)
+{
+    return _mm512_min_ps(_mm512_max_ps(coeff, _mm512_set1_ps(-0.3f)),
+                         _mm512_set1_ps(0.3f));
+}
+
+__attribute__((target(AVX512)))
+static inline __m512i chroma_index_avx512(__m512 value)
+{
+    __m512i index = _mm512_setzero_si512();
+    for (int j = 0; j < CHROMA_LEVELS - 1; j++)
+    {
+        __mmask16 above = _mm512_cmp_ps_mask(
+                              value, _mm512_set1_ps(CHROMA_THRESHOLDS[j]),
+                              _CMP_GE_OQ);
+        index = _mm512_mask_add_epi32(index, above, index,
+                                      _mm512_set1_epi32(1));
+    }
+    return index;
+}
+
+__attribute__((target(AVX512)))
+static inline __m512 mean_fixed_avx512(__m512i sum)
+{
+    return _mm512_mul_ps(_mm512_cvtepi32_ps(sum),
+                         _mm512_set1_ps(1.0f / (1 << SUM_FIXED_BITS)));
+}
+
+__attribute__((target(AVX512)))
+static inline __m512i field_avx512(__m512i words, unsigned width,
+                                   unsigned lsb, int is_signed)
+{
+    __m512i top = _mm512_slli_epi32(words, 32 - width - lsb);
+    return is_signed ? _mm512_srai_epi32(top, 32 - width)
+                     : _mm512_srli_epi32(top, 32 - width);
+}
+
+/* the whole table fits in one register */
+__attribute__((target(AVX512)))
+static inline __m512 chroma_of_index_avx512(__m512i index)
+{
+    return _mm512_permutexvar_ps(index, _mm512_loadu_ps(CHROMA_OF_INDEX));
+}
+
+#endif
+#endif